@@ -0,0 +1,270 @@
+// alloctrack.c
+// Allocation counting for the ALLOC_TRACKING debug build. See alloctrack.h.
+
+#include "alloctrack.h"
+
+#ifdef ALLOC_TRACKING
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+
+// Where an allocation came in
+enum
+{
+    SOURCE_LIBC, // malloc and friends, glibc only
+    SOURCE_SDL,  // SDL_malloc and friends
+    SOURCE_COUNT
+};
+
+typedef struct
+{
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+} AllocCount;
+
+static const char *phase_names[ALLOC_PHASE_COUNT] = {"other", "input", "simulate", "render", "present"};
+static const char *source_names[SOURCE_COUNT] = {"libc", "SDL"};
+
+static AllocCount frame_counts[ALLOC_PHASE_COUNT][SOURCE_COUNT];
+static AllocCount total_counts[ALLOC_PHASE_COUNT][SOURCE_COUNT];
+static int current_phase = ALLOC_PHASE_OTHER;
+static bool strict_mode = false;
+static uint64_t frames = 0, steady_frames = 0, allocating_steady_frames = 0;
+
+// Logged in full up to this many times, then only counted
+#define MAX_LOGGED_FRAMES 10
+
+// Relaxed atomics: SDL may allocate from its own threads
+static void count_alloc(int source, size_t bytes)
+{
+    AllocCount *c = &frame_counts[__atomic_load_n(&current_phase, __ATOMIC_RELAXED)][source];
+    __atomic_fetch_add(&c->allocs, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&c->bytes, bytes, __ATOMIC_RELAXED);
+}
+
+static void count_free(int source, void *ptr)
+{
+    if (!ptr)
+        return;
+    AllocCount *c = &frame_counts[__atomic_load_n(&current_phase, __ATOMIC_RELAXED)][source];
+    __atomic_fetch_add(&c->frees, 1, __ATOMIC_RELAXED);
+}
+
+#ifdef __GLIBC__
+
+// glibc exports its allocator under these names too, which is what lets
+// the definitions below stand in for malloc everywhere in the process
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+extern void __libc_free(void *ptr);
+
+void *malloc(size_t size)
+{
+    count_alloc(SOURCE_LIBC, size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    count_alloc(SOURCE_LIBC, count * size);
+    return __libc_calloc(count, size);
+}
+
+// realloc(ptr, 0) frees ptr in glibc, so it counts as a free
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr && size == 0)
+        count_free(SOURCE_LIBC, ptr);
+    else
+        count_alloc(SOURCE_LIBC, size);
+    return __libc_realloc(ptr, size);
+}
+
+void *reallocarray(void *ptr, size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, count * size);
+}
+
+// The aligned allocators are freed with free(), so they must be counted
+// going in as well or allocs and frees disagree. FreeType and GL drivers
+// use them.
+void *memalign(size_t alignment, size_t size)
+{
+    count_alloc(SOURCE_LIBC, size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void *ptr = memalign(alignment, size);
+    if (!ptr)
+        return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    count_alloc(SOURCE_LIBC, size);
+    return __libc_valloc(size);
+}
+
+void *pvalloc(size_t size)
+{
+    count_alloc(SOURCE_LIBC, size);
+    return __libc_pvalloc(size);
+}
+
+void free(void *ptr)
+{
+    count_free(SOURCE_LIBC, ptr);
+    __libc_free(ptr);
+}
+
+// SDL's hooks go straight to glibc so they are not counted twice
+#define real_sdl_malloc __libc_malloc
+#define real_sdl_calloc __libc_calloc
+#define real_sdl_realloc __libc_realloc
+#define real_sdl_free __libc_free
+
+#else
+
+static SDL_malloc_func real_sdl_malloc;
+static SDL_calloc_func real_sdl_calloc;
+static SDL_realloc_func real_sdl_realloc;
+static SDL_free_func real_sdl_free;
+
+#endif
+
+static void *SDLCALL tracked_sdl_malloc(size_t size)
+{
+    count_alloc(SOURCE_SDL, size);
+    return real_sdl_malloc(size);
+}
+
+static void *SDLCALL tracked_sdl_calloc(size_t count, size_t size)
+{
+    count_alloc(SOURCE_SDL, count * size);
+    return real_sdl_calloc(count, size);
+}
+
+static void *SDLCALL tracked_sdl_realloc(void *ptr, size_t size)
+{
+    if (ptr && size == 0)
+        count_free(SOURCE_SDL, ptr);
+    else
+        count_alloc(SOURCE_SDL, size);
+    return real_sdl_realloc(ptr, size);
+}
+
+static void SDLCALL tracked_sdl_free(void *ptr)
+{
+    count_free(SOURCE_SDL, ptr);
+    real_sdl_free(ptr);
+}
+
+void alloc_track_init()
+{
+#ifndef __GLIBC__
+    SDL_GetMemoryFunctions(&real_sdl_malloc, &real_sdl_calloc, &real_sdl_realloc, &real_sdl_free);
+#endif
+    if (SDL_SetMemoryFunctions(tracked_sdl_malloc, tracked_sdl_calloc, tracked_sdl_realloc, tracked_sdl_free) != 0)
+        printf("Allocation tracking: could not hook SDL's allocator\n");
+}
+
+void alloc_track_set_strict(bool strict)
+{
+    strict_mode = strict;
+}
+
+void alloc_track_phase(AllocPhase phase)
+{
+    __atomic_store_n(&current_phase, (int)phase, __ATOMIC_RELAXED);
+}
+
+static void print_counts(FILE *out, AllocCount counts[ALLOC_PHASE_COUNT][SOURCE_COUNT])
+{
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++)
+    {
+        for (int s = 0; s < SOURCE_COUNT; s++)
+        {
+            const AllocCount *c = &counts[p][s];
+            if (c->allocs || c->frees)
+                fprintf(out, "  %-8s %-4s %8llu allocs %8llu frees %10llu bytes\n", phase_names[p], source_names[s],
+                        (unsigned long long)c->allocs, (unsigned long long)c->frees,
+                        (unsigned long long)c->bytes);
+        }
+    }
+}
+
+void alloc_track_frame_end(bool steady)
+{
+    // Take the frame's counts before anything below can add to them
+    AllocCount counts[ALLOC_PHASE_COUNT][SOURCE_COUNT];
+    uint64_t allocs = 0;
+    for (int p = 0; p < ALLOC_PHASE_COUNT; p++)
+    {
+        for (int s = 0; s < SOURCE_COUNT; s++)
+        {
+            AllocCount *c = &frame_counts[p][s];
+            counts[p][s].allocs = __atomic_exchange_n(&c->allocs, 0, __ATOMIC_RELAXED);
+            counts[p][s].frees = __atomic_exchange_n(&c->frees, 0, __ATOMIC_RELAXED);
+            counts[p][s].bytes = __atomic_exchange_n(&c->bytes, 0, __ATOMIC_RELAXED);
+
+            total_counts[p][s].allocs += counts[p][s].allocs;
+            total_counts[p][s].frees += counts[p][s].frees;
+            total_counts[p][s].bytes += counts[p][s].bytes;
+            allocs += counts[p][s].allocs;
+        }
+    }
+
+    frames++;
+    if (!steady)
+        return;
+    steady_frames++;
+    if (allocs == 0)
+        return;
+
+    allocating_steady_frames++;
+    if (allocating_steady_frames <= MAX_LOGGED_FRAMES || strict_mode)
+    {
+        printf("Steady frame %llu allocated %llu times:\n", (unsigned long long)frames, (unsigned long long)allocs);
+        print_counts(stdout, counts);
+        if (allocating_steady_frames == MAX_LOGGED_FRAMES && !strict_mode)
+            printf("(further allocating frames are only counted)\n");
+    }
+    if (strict_mode)
+    {
+        fflush(stdout);
+        abort();
+    }
+}
+
+void alloc_track_report(FILE *out)
+{
+    fprintf(out, "Allocations: %llu frames, %llu steady, %llu steady frames allocated\n",
+            (unsigned long long)frames, (unsigned long long)steady_frames,
+            (unsigned long long)allocating_steady_frames);
+    print_counts(out, total_counts);
+}
+
+#endif
@@ -0,0 +1,56 @@
+// alloctrack.h
+// Debug build mode that counts heap allocations per frame, split by the
+// profiling phase the game loop is in. Build with ALLOC_TRACKING=1
+// ./build_game.sh (-DALLOC_TRACKING); otherwise every call here compiles
+// to nothing.
+//
+// With glibc, malloc/calloc/realloc/free and the aligned allocators
+// (posix_memalign, aligned_alloc, memalign, valloc) are replaced for the
+// whole process, so SDL, SDL_ttf and FreeType are counted along with our
+// own code. SDL_SetMemoryFunctions hooks SDL's allocator as well, and those
+// allocations are reported under their own column. Other C libraries
+// cannot be replaced this way, so there only the SDL column is filled.
+// Allocations made on other threads count toward whatever phase the main
+// thread is in at the time.
+//
+// A steady frame is ordinary play with nothing starting, ending or being
+// rewound. It should not allocate at all. One that does is logged with its
+// phase breakdown, and alloc_track_set_strict(true) turns that into an
+// abort.
+
+#ifndef ALLOCTRACK_H
+#define ALLOCTRACK_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+typedef enum
+{
+    ALLOC_PHASE_OTHER,
+    ALLOC_PHASE_INPUT,
+    ALLOC_PHASE_SIMULATE,
+    ALLOC_PHASE_RENDER,
+    ALLOC_PHASE_PRESENT, // render queue flush and SDL_RenderPresent
+    ALLOC_PHASE_COUNT
+} AllocPhase;
+
+#ifdef ALLOC_TRACKING
+
+// Call before SDL_Init so SDL's first allocation is already hooked
+void alloc_track_init();
+void alloc_track_set_strict(bool strict);
+void alloc_track_phase(AllocPhase phase);
+void alloc_track_frame_end(bool steady);
+void alloc_track_report(FILE *out);
+
+#else
+
+#define alloc_track_init() ((void)0)
+#define alloc_track_set_strict(strict) ((void)(strict))
+#define alloc_track_phase(phase) ((void)0)
+#define alloc_track_frame_end(steady) ((void)(steady))
+#define alloc_track_report(out) ((void)0)
+
+#endif
+
+#endif
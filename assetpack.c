@@ -0,0 +1,233 @@
+// assetpack.c
+// Build step that compresses files into a C source the game links against
+// (see assets.h for the format). Runs on the build machine only.
+//
+// usage: assetpack out.c name=path [name=path ...]
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Must match assets.h
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define MAX_ASSETS 16
+
+#define HASH_BITS 16
+#define CHAIN_DEPTH 64 // candidates tried per position
+
+static uint8_t *read_file(const char *path, size_t *size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = malloc(length > 0 ? (size_t)length : 1);
+    if (data && fread(data, 1, (size_t)length, f) != (size_t)length)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (size_t)length;
+    return data;
+}
+
+static uint32_t hash4(const uint8_t *p)
+{
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static size_t put_length(uint8_t *out, size_t length)
+{
+    size_t n = 0;
+    while (length >= 255)
+    {
+        out[n++] = 255;
+        length -= 255;
+    }
+    out[n++] = (uint8_t)length;
+    return n;
+}
+
+static size_t put_sequence(uint8_t *out, const uint8_t *literals, size_t literal_count,
+                           size_t offset, size_t match_length)
+{
+    size_t n = 0;
+    size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+    out[n++] = (uint8_t)(((literal_count < 15 ? literal_count : 15) << 4) |
+                         (match_code < 15 ? match_code : 15));
+    if (literal_count >= 15)
+        n += put_length(out + n, literal_count - 15);
+    memcpy(out + n, literals, literal_count);
+    n += literal_count;
+
+    if (match_length)
+    {
+        out[n++] = (uint8_t)(offset & 0xFF);
+        out[n++] = (uint8_t)(offset >> 8);
+        if (match_code >= 15)
+            n += put_length(out + n, match_code - 15);
+    }
+    return n;
+}
+
+// Greedy LZ with hash chains. out needs size + size / 255 + 16 bytes.
+static size_t deflate(const uint8_t *src, size_t size, uint8_t *out)
+{
+    int32_t *head = malloc(sizeof(int32_t) << HASH_BITS);
+    int32_t *chain = malloc(sizeof(int32_t) * (size ? size : 1));
+    if (!head || !chain)
+    {
+        free(head);
+        free(chain);
+        return 0;
+    }
+    memset(head, -1, sizeof(int32_t) << HASH_BITS);
+
+    size_t n = 0;
+    size_t anchor = 0; // first literal not yet written
+    size_t pos = 0;
+
+    while (pos + MIN_MATCH <= size)
+    {
+        uint32_t h = hash4(src + pos);
+        size_t best_length = 0, best_offset = 0;
+
+        int tries = CHAIN_DEPTH;
+        for (int32_t candidate = head[h]; candidate >= 0 && tries-- > 0; candidate = chain[candidate])
+        {
+            size_t offset = pos - (size_t)candidate;
+            if (offset > MAX_OFFSET)
+                break;
+
+            size_t length = 0;
+            while (pos + length < size && src[candidate + length] == src[pos + length])
+                length++;
+            if (length > best_length)
+            {
+                best_length = length;
+                best_offset = offset;
+            }
+        }
+
+        if (best_length < MIN_MATCH)
+        {
+            chain[pos] = head[h];
+            head[h] = (int32_t)pos;
+            pos++;
+            continue;
+        }
+
+        n += put_sequence(out + n, src + anchor, pos - anchor, best_offset, best_length);
+
+        // Index every position the match covers so later matches can find them
+        size_t stop = pos + best_length;
+        for (; pos < stop; pos++)
+        {
+            if (pos + MIN_MATCH <= size)
+            {
+                uint32_t hp = hash4(src + pos);
+                chain[pos] = head[hp];
+                head[hp] = (int32_t)pos;
+            }
+        }
+        anchor = pos;
+    }
+
+    // Trailing literals end the stream
+    n += put_sequence(out + n, src + anchor, size - anchor, 0, 0);
+
+    free(head);
+    free(chain);
+    return n;
+}
+
+static void write_array(FILE *out, int index, const uint8_t *data, size_t size)
+{
+    fprintf(out, "static const uint8_t asset_%d[] = {", index);
+    for (size_t i = 0; i < size; i++)
+        fprintf(out, "%s%u,", (i % 24) ? "" : "\n    ", data[i]);
+    fprintf(out, "\n};\n\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: assetpack out.c name=path [name=path ...]\n");
+        return 1;
+    }
+    if (argc - 2 > MAX_ASSETS)
+    {
+        printf("At most %d assets\n", MAX_ASSETS);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out)
+    {
+        printf("Could not write %s\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by assetpack, do not edit.\n\n#include \"assets.h\"\n\n");
+
+    int count = argc - 2;
+    char names[MAX_ASSETS][64];
+    size_t sizes[MAX_ASSETS], packed_sizes[MAX_ASSETS];
+
+    for (int i = 0; i < count; i++)
+    {
+        const char *arg = argv[i + 2];
+        const char *eq = strchr(arg, '=');
+        if (!eq || eq == arg || (size_t)(eq - arg) >= sizeof(names[i]))
+        {
+            printf("Expected name=path, got %s\n", arg);
+            fclose(out);
+            return 1;
+        }
+        snprintf(names[i], sizeof(names[i]), "%.*s", (int)(eq - arg), arg);
+
+        size_t size;
+        uint8_t *data = read_file(eq + 1, &size);
+        if (!data)
+        {
+            printf("Could not read %s\n", eq + 1);
+            fclose(out);
+            return 1;
+        }
+
+        uint8_t *packed = malloc(size + size / 255 + 16);
+        size_t packed_size = packed ? deflate(data, size, packed) : 0;
+        if (!packed_size)
+        {
+            printf("Could not compress %s\n", eq + 1);
+            fclose(out);
+            return 1;
+        }
+
+        write_array(out, i, packed, packed_size);
+        sizes[i] = size;
+        packed_sizes[i] = packed_size;
+        printf("%-12s %8zu -> %8zu bytes (%.0f%%)\n", names[i], size, packed_size,
+               size ? 100.0 * packed_size / size : 100.0);
+
+        free(packed);
+        free(data);
+    }
+
+    fprintf(out, "const PackedAsset packed_assets[] = {\n");
+    for (int i = 0; i < count; i++)
+        fprintf(out, "    {\"%s\", asset_%d, %zu, %zu},\n", names[i], i, packed_sizes[i], sizes[i]);
+    fprintf(out, "};\n\nconst int packed_asset_count = %d;\n", count);
+
+    fclose(out);
+    return 0;
+}
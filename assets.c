@@ -0,0 +1,127 @@
+// assets.c
+// Lazy access to the assets packed into the executable. See assets.h.
+
+#include <stdlib.h>
+#include <string.h>
+#include "assets.h"
+
+// Inflated copies, filled on first use
+static uint8_t *inflated[ASSET_MAX];
+static double inflate_ms = 0;
+
+static size_t read_length(const uint8_t **src, const uint8_t *end, size_t length)
+{
+    if (length != 15)
+        return length;
+
+    uint8_t byte;
+    do
+    {
+        if (*src >= end)
+            return (size_t)-1;
+        byte = *(*src)++;
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+static size_t inflate(const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size)
+{
+    const uint8_t *end = src + src_size;
+    size_t out = 0;
+
+    while (src < end)
+    {
+        uint8_t token = *src++;
+
+        size_t literals = read_length(&src, end, token >> 4);
+        if (literals == (size_t)-1 || literals > (size_t)(end - src) || literals > dst_size - out)
+            return 0;
+        memcpy(dst + out, src, literals);
+        src += literals;
+        out += literals;
+
+        // The last sequence stops after its literals
+        if (src == end)
+            break;
+
+        if (end - src < 2)
+            return 0;
+        size_t offset = src[0] | (src[1] << 8);
+        src += 2;
+
+        size_t length = read_length(&src, end, token & 15);
+        if (length == (size_t)-1 || offset == 0 || offset > out)
+            return 0;
+        length += ASSET_MIN_MATCH;
+        if (length > dst_size - out)
+            return 0;
+
+        // Byte by byte, matches may overlap what they are copying
+        for (size_t i = 0; i < length; i++, out++)
+            dst[out] = dst[out - offset];
+    }
+    return out;
+}
+
+static int find(const char *name)
+{
+    for (int i = 0; i < packed_asset_count && i < ASSET_MAX; i++)
+    {
+        if (strcmp(packed_assets[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+const uint8_t *asset_data(const char *name, size_t *size)
+{
+    int i = find(name);
+    if (i < 0)
+        return NULL;
+
+    const PackedAsset *asset = &packed_assets[i];
+    if (!inflated[i])
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+
+        uint8_t *data = malloc(asset->size ? asset->size : 1);
+        if (!data)
+            return NULL;
+        if (inflate(asset->packed, asset->packed_size, data, asset->size) != asset->size)
+        {
+            free(data);
+            return NULL;
+        }
+        inflated[i] = data;
+
+        inflate_ms += (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    }
+
+    if (size)
+        *size = asset->size;
+    return inflated[i];
+}
+
+SDL_RWops *asset_open(const char *name)
+{
+    size_t size;
+    const uint8_t *data = asset_data(name, &size);
+    if (!data)
+        return NULL;
+    return SDL_RWFromConstMem(data, (int)size);
+}
+
+double asset_inflate_ms()
+{
+    return inflate_ms;
+}
+
+void assets_free()
+{
+    for (int i = 0; i < ASSET_MAX; i++)
+    {
+        free(inflated[i]);
+        inflated[i] = NULL;
+    }
+}
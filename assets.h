@@ -0,0 +1,50 @@
+// assets.h
+// Files baked into the executable by assetpack (see build_game.sh), so the
+// game no longer depends on a font sitting next to it. Each asset is stored
+// LZ compressed in assets_data.c and only inflated the first time it is
+// opened; the inflated copy stays cached until assets_free().
+//
+// Compressed format (LZ4 block style), a sequence of:
+//   token      high nibble = literal count, low nibble = match length - 4
+//   [255...]   extra literal count bytes while the nibble is 15
+//   literals
+//   offset     2 bytes little endian, distance back into the output
+//   [255...]   extra match length bytes while the nibble is 15
+// The last sequence has literals only.
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#define ASSET_MIN_MATCH 4
+#define ASSET_MAX_OFFSET 65535
+#define ASSET_MAX 16 // assets per executable
+
+typedef struct
+{
+    const char *name;
+    const uint8_t *packed;
+    uint32_t packed_size;
+    uint32_t size; // after inflating
+} PackedAsset;
+
+// Generated by assetpack
+extern const PackedAsset packed_assets[];
+extern const int packed_asset_count;
+
+// Inflated bytes of an asset, or NULL if it is missing or corrupt
+const uint8_t *asset_data(const char *name, size_t *size);
+
+// Read-only stream over an asset for SDL loaders (TTF_OpenFontRW etc).
+// The memory stays valid until assets_free().
+SDL_RWops *asset_open(const char *name);
+
+// Time spent inflating so far, for the startup report
+double asset_inflate_ms();
+
+void assets_free();
+
+#endif
@@ -0,0 +1,351 @@
+// audio.c
+// Lock-free sound mixer. See audio.h.
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "audio.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define QUEUE_MASK (AUDIO_QUEUE_SIZE - 1)
+#define TWO_PI 6.28318531f
+
+#if (AUDIO_QUEUE_SIZE & QUEUE_MASK) != 0
+#error "AUDIO_QUEUE_SIZE must be a power of two"
+#endif
+
+typedef struct
+{
+    int16_t *pcm;
+    int length; // samples, padded to a multiple of 8 so mixing runs whole vectors
+    int priority;
+} Sound;
+
+typedef struct
+{
+    const Sound *sound; // NULL when the voice is free
+    int position;
+} Voice;
+
+static SDL_AudioDeviceID device = 0;
+static Sound sounds[SOUND_COUNT];
+
+// The ring: the game thread owns head, the callback owns tail
+static uint8_t queue[AUDIO_QUEUE_SIZE];
+static _Alignas(64) _Atomic uint32_t queue_head;
+static _Alignas(64) _Atomic uint32_t queue_tail;
+static uint64_t triggers = 0, dropped = 0; // game thread
+
+// Everything below is the callback's alone while the device runs
+static Voice voices[AUDIO_MAX_VOICES];
+static uint64_t buffers = 0, started = 0, stolen = 0, refused = 0;
+static uint64_t callback_total = 0, callback_max = 0; // performance counter ticks
+static uint32_t callback_ticks[AUDIO_TIMING_SAMPLES];
+
+// ---- Sample cache ----
+
+// Deterministic noise, so every run sounds the same
+static uint32_t noise_state = 0x9e3779b9;
+
+static float noise()
+{
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return (float)(noise_state >> 8) / (float)(1 << 23) - 1.0f;
+}
+
+static bool alloc_sound(SoundId id, float seconds, int priority)
+{
+    int length = ((int)(seconds * AUDIO_RATE) + 7) & ~7;
+    sounds[id].pcm = calloc((size_t)length, sizeof(int16_t));
+    sounds[id].length = length;
+    sounds[id].priority = priority;
+    return sounds[id].pcm != NULL;
+}
+
+static int16_t to_pcm(float v)
+{
+    if (v > 1.0f)
+        v = 1.0f;
+    if (v < -1.0f)
+        v = -1.0f;
+    return (int16_t)(v * 32767.0f);
+}
+
+// A square wave sweeping from one pitch to another with a falling envelope
+static void synth_sweep(SoundId id, float from_hz, float to_hz, float volume, float noise_mix)
+{
+    Sound *s = &sounds[id];
+    float phase = 0.0f;
+    for (int i = 0; i < s->length; i++)
+    {
+        float t = (float)i / s->length;
+        float hz = from_hz + (to_hz - from_hz) * t;
+        phase += hz / AUDIO_RATE;
+        phase -= floorf(phase);
+        float square = phase < 0.5f ? 1.0f : -1.0f;
+        float envelope = (1.0f - t) * (1.0f - t);
+        s->pcm[i] = to_pcm(volume * envelope * (square * (1.0f - noise_mix) + noise() * noise_mix));
+    }
+}
+
+// Three notes one after the other
+static void synth_jingle(SoundId id, const float notes_hz[3], float volume)
+{
+    Sound *s = &sounds[id];
+    int note_length = s->length / 3;
+    for (int i = 0; i < s->length; i++)
+    {
+        int note = i / note_length < 3 ? i / note_length : 2;
+        float t = (float)(i - note * note_length) / note_length;
+        float v = sinf(TWO_PI * notes_hz[note] * i / AUDIO_RATE);
+        s->pcm[i] = to_pcm(volume * (1.0f - t) * v);
+    }
+}
+
+static bool build_sounds()
+{
+    static const float win_notes[3] = {523.25f, 659.25f, 783.99f};
+    static const float lose_notes[3] = {392.0f, 311.13f, 261.63f};
+
+    if (!alloc_sound(SOUND_SHOT, 0.08f, 0) || !alloc_sound(SOUND_HIT, 0.06f, 1) ||
+        !alloc_sound(SOUND_KILL, 0.35f, 2) || !alloc_sound(SOUND_WIN, 0.6f, 3) ||
+        !alloc_sound(SOUND_LOSE, 0.6f, 3))
+        return false;
+
+    synth_sweep(SOUND_SHOT, 1400.0f, 500.0f, 0.2f, 0.0f);
+    synth_sweep(SOUND_HIT, 260.0f, 180.0f, 0.3f, 0.3f);
+    synth_sweep(SOUND_KILL, 160.0f, 40.0f, 0.4f, 0.8f);
+    synth_jingle(SOUND_WIN, win_notes, 0.35f);
+    synth_jingle(SOUND_LOSE, lose_notes, 0.35f);
+    return true;
+}
+
+static void free_sounds()
+{
+    for (int i = 0; i < SOUND_COUNT; i++)
+    {
+        free(sounds[i].pcm);
+        sounds[i].pcm = NULL;
+    }
+}
+
+// ---- Callback ----
+
+static void mix_add(int16_t *out, const int16_t *in, int count)
+{
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(out + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(in + i));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_adds_epi16(a, b));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        int v = out[i] + in[i];
+        out[i] = (int16_t)(v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : v);
+    }
+}
+
+static void start_voice(const Sound *sound)
+{
+    // A free voice, or else the least important one, furthest along
+    int pick = -1;
+    for (int v = 0; v < AUDIO_MAX_VOICES; v++)
+    {
+        if (!voices[v].sound)
+        {
+            pick = v;
+            break;
+        }
+        if (pick < 0 || voices[v].sound->priority < voices[pick].sound->priority ||
+            (voices[v].sound->priority == voices[pick].sound->priority &&
+             voices[v].position > voices[pick].position))
+            pick = v;
+    }
+
+    if (voices[pick].sound)
+    {
+        if (voices[pick].sound->priority > sound->priority)
+        {
+            refused++;
+            return;
+        }
+        stolen++;
+    }
+    voices[pick].sound = sound;
+    voices[pick].position = 0;
+    started++;
+}
+
+static void SDLCALL audio_callback(void *userdata, Uint8 *stream, int len)
+{
+    (void)userdata;
+    Uint64 begin = SDL_GetPerformanceCounter();
+
+    uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_acquire);
+    for (; tail != head; tail++)
+        start_voice(&sounds[queue[tail & QUEUE_MASK]]);
+    atomic_store_explicit(&queue_tail, tail, memory_order_release);
+
+    int16_t *out = (int16_t *)stream;
+    int samples = len / (int)sizeof(int16_t);
+    memset(stream, 0, (size_t)len);
+    for (int v = 0; v < AUDIO_MAX_VOICES; v++)
+    {
+        Voice *voice = &voices[v];
+        if (!voice->sound)
+            continue;
+        int count = voice->sound->length - voice->position;
+        if (count > samples)
+            count = samples;
+        mix_add(out, voice->sound->pcm + voice->position, count);
+        voice->position += count;
+        if (voice->position >= voice->sound->length)
+            voice->sound = NULL;
+    }
+
+    Uint64 ticks = SDL_GetPerformanceCounter() - begin;
+    callback_ticks[buffers % AUDIO_TIMING_SAMPLES] = ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks;
+    callback_total += ticks;
+    if (ticks > callback_max)
+        callback_max = ticks;
+    buffers++;
+}
+
+// ---- Game thread ----
+
+bool audio_open()
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0)
+    {
+        printf("Audio Init Error: %s\n", SDL_GetError());
+        return false;
+    }
+    if (!build_sounds())
+    {
+        printf("Audio: out of memory for the sample cache\n");
+        free_sounds();
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    // No allowed changes: SDL converts if the hardware wants something
+    // else, so the callback always sees mono 16-bit at AUDIO_RATE
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = AUDIO_RATE;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = AUDIO_BUFFER_SAMPLES;
+    want.callback = audio_callback;
+    device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (device == 0)
+    {
+        printf("Audio Device Error: %s\n", SDL_GetError());
+        free_sounds();
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    printf("Audio: %s driver, %d Hz, %d samples per buffer\n", SDL_GetCurrentAudioDriver(), have.freq,
+           have.samples);
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+void audio_play(SoundId sound)
+{
+    if (device == 0)
+        return;
+
+    triggers++;
+    uint32_t head = atomic_load_explicit(&queue_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&queue_tail, memory_order_acquire);
+    if (head - tail == AUDIO_QUEUE_SIZE)
+    {
+        dropped++; // the callback has stalled; sound is not worth blocking for
+        return;
+    }
+    queue[head & QUEUE_MASK] = (uint8_t)sound;
+    atomic_store_explicit(&queue_head, head + 1, memory_order_release);
+}
+
+void audio_game_event(GameEventType type)
+{
+    static const SoundId event_sounds[] = {
+        [GAME_EVENT_SHOT] = SOUND_SHOT,
+        [GAME_EVENT_HIT] = SOUND_HIT,
+        [GAME_EVENT_KILL] = SOUND_KILL,
+        [GAME_EVENT_WIN] = SOUND_WIN,
+        [GAME_EVENT_LOSE] = SOUND_LOSE,
+    };
+    audio_play(event_sounds[type]);
+}
+
+static int compare_ticks(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+void audio_report(FILE *out)
+{
+    if (device == 0)
+        return;
+
+    // Pausing takes the device lock, so the callback is not running once
+    // this returns and its counters can be read directly
+    SDL_PauseAudioDevice(device, 1);
+    if (buffers == 0)
+        return;
+
+    static uint32_t sorted[AUDIO_TIMING_SAMPLES];
+    int n = buffers < AUDIO_TIMING_SAMPLES ? (int)buffers : AUDIO_TIMING_SAMPLES;
+    memcpy(sorted, callback_ticks, n * sizeof(uint32_t));
+    qsort(sorted, n, sizeof(uint32_t), compare_ticks);
+
+    double us = 1e6 / SDL_GetPerformanceFrequency();
+    fprintf(out, "Audio callback (%llu buffers, %.1f ms each): mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            (unsigned long long)buffers, AUDIO_BUFFER_SAMPLES * 1000.0 / AUDIO_RATE,
+            callback_total * us / buffers, sorted[n / 2] * us, sorted[n * 99 / 100] * us, callback_max * us);
+    fprintf(out, "Audio voices: %llu triggers, %llu started, %llu stolen, %llu refused, %llu dropped\n",
+            (unsigned long long)triggers, (unsigned long long)started, (unsigned long long)stolen,
+            (unsigned long long)refused, (unsigned long long)dropped);
+}
+
+bool audio_stats(AudioStats *stats)
+{
+    if (device == 0)
+        return false;
+
+    // Paused as in audio_report(), so the callback's counters are still
+    SDL_PauseAudioDevice(device, 1);
+    stats->buffers = buffers;
+    stats->triggers = triggers;
+    stats->started = started;
+    stats->stolen = stolen;
+    stats->refused = refused;
+    stats->dropped = dropped;
+    return true;
+}
+
+void audio_close()
+{
+    if (device == 0)
+        return;
+    SDL_CloseAudioDevice(device);
+    device = 0;
+    free_sounds();
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
@@ -0,0 +1,67 @@
+// audio.h
+// Built-in sound for shots, hits, kills and the end of a game. The game
+// thread only pushes one-byte triggers into a single-producer,
+// single-consumer ring. The SDL audio callback pops them, starts voices and
+// mixes, so the two sides never share a lock. Every sound is synthesized
+// into a PCM cache when the device opens, which leaves the callback with
+// nothing to decode or allocate: it clears the buffer and adds the playing
+// voices into it with saturating 16-bit adds (SSE2 where available).
+//
+// At most AUDIO_MAX_VOICES sounds play at once. A trigger that finds them
+// all busy takes over the lowest-priority voice (the one furthest along,
+// on a tie) if its own priority is at least as high, and is refused
+// otherwise. Kills and the win/lose jingles therefore always get through
+// a burst of shots.
+//
+// Works with any SDL audio driver, including "dummy" and "disk" on a
+// machine with no sound card (see audiotest.c).
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "game.h"
+
+#define AUDIO_RATE 48000
+#define AUDIO_BUFFER_SAMPLES 512 // per callback, about 10.7 ms
+#define AUDIO_MAX_VOICES 8
+#define AUDIO_QUEUE_SIZE 256     // triggers in flight, power of two
+#define AUDIO_TIMING_SAMPLES 4096 // most recent callbacks kept for the report
+
+typedef enum
+{
+    SOUND_SHOT,
+    SOUND_HIT,
+    SOUND_KILL,
+    SOUND_WIN,
+    SOUND_LOSE,
+    SOUND_COUNT
+} SoundId;
+
+// Opens the default output device (or whatever SDL_AUDIODRIVER names) and
+// starts mixing. Returns false, leaving audio_play() a no-op, if there is
+// no device.
+bool audio_open();
+
+// Game thread only
+void audio_play(SoundId sound);
+void audio_game_event(GameEventType type);
+
+typedef struct
+{
+    uint64_t buffers; // callbacks run
+    uint64_t triggers, started, stolen, refused, dropped;
+} AudioStats;
+
+// Stops the callback and prints callback time per buffer and voice use
+void audio_report(FILE *out);
+
+// Stops the callback and copies its counters out, for tests. Returns false
+// if there is no device.
+bool audio_stats(AudioStats *stats);
+
+void audio_close();
+
+#endif
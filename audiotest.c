@@ -0,0 +1,79 @@
+// audiotest.c
+// Runs the mixer (audio.c) without a window or a sound card. Picks SDL's
+// dummy driver unless told otherwise, fires sound triggers at 60 ticks a
+// second the way a busy game would, with a burst every second that is
+// bigger than the voice cap, and prints the callback report. With --driver
+// disk the mixed output is written to sdlaudio.raw (16-bit mono at
+// AUDIO_RATE) so it can be listened to or compared between builds.
+//
+// It fails (exit 1) unless the callback ran, the bursts made voices be
+// stolen, and no trigger was dropped for a full queue.
+//
+// usage: audiotest [--driver dummy|disk|NAME] [--seconds S]
+
+#define SDL_MAIN_HANDLED
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <SDL2/SDL.h>
+#include "audio.h"
+
+int main(int argc, char *argv[])
+{
+    const char *driver = "dummy";
+    int seconds = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--driver") == 0 && i + 1 < argc)
+            driver = argv[++i];
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = atoi(argv[++i]);
+        else
+        {
+            printf("usage: audiotest [--driver dummy|disk|NAME] [--seconds S]\n");
+            return 1;
+        }
+    }
+
+    SDL_setenv("SDL_AUDIODRIVER", driver, 1);
+    if (SDL_Init(0) < 0 || !audio_open())
+    {
+        printf("Could not open the %s audio driver\n", driver);
+        return 1;
+    }
+
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 tick_length = frequency / 60;
+    Uint64 next = SDL_GetPerformanceCounter();
+    for (int tick = 0; tick < seconds * 60; tick++)
+    {
+        // A shot every few ticks, some hits and kills, and once a second
+        // a pile-up of everything so voices have to be stolen
+        if (tick % 4 == 0)
+            audio_game_event(GAME_EVENT_SHOT);
+        if (tick % 9 == 0)
+            audio_game_event(GAME_EVENT_HIT);
+        if (tick % 30 == 0)
+            audio_game_event(GAME_EVENT_KILL);
+        if (tick % 60 == 59)
+        {
+            for (int k = 0; k < AUDIO_MAX_VOICES; k++)
+                audio_game_event(GAME_EVENT_SHOT);
+            audio_game_event(GAME_EVENT_KILL);
+            audio_game_event(tick % 120 == 59 ? GAME_EVENT_WIN : GAME_EVENT_LOSE);
+        }
+
+        next += tick_length;
+        while (SDL_GetPerformanceCounter() < next)
+            SDL_Delay(1);
+    }
+
+    audio_report(stdout);
+    AudioStats stats = {0};
+    bool ok = audio_stats(&stats) && stats.buffers > 0 && stats.stolen > 0 && stats.dropped == 0;
+    printf("audiotest: %llu buffers, %llu stolen, %llu dropped: %s\n", (unsigned long long)stats.buffers,
+           (unsigned long long)stats.stolen, (unsigned long long)stats.dropped, ok ? "ok" : "WRONG");
+    audio_close();
+    SDL_Quit();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// bot.c
+// Bot policies. Each policy is a function in the table at the bottom;
+// adding one means writing the function and giving it a name there.
+
+#include <math.h>
+#include <string.h>
+#include "game.h"
+#include "bot.h"
+
+#define FIRE_COOLDOWN 6 // ticks between shots for the aiming bots
+#define AIM_TOLERANCE 8 // pixels either side of the aim point
+
+static uint32_t bot_rand(Bot *bot)
+{
+    uint32_t x = bot->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    bot->rng = x;
+    return x;
+}
+
+static int player_x(int player)
+{
+    return player == 0 ? shooter_x : partner_x;
+}
+
+// Steer toward aim_x and fire once lined up
+static uint8_t aim_at(Bot *bot, int player, float aim_x)
+{
+    uint8_t input = 0;
+    float error = aim_x - player_x(player);
+
+    if (error < -AIM_TOLERANCE)
+        input |= INPUT_LEFT;
+    else if (error > AIM_TOLERANCE)
+        input |= INPUT_RIGHT;
+    else if (bot->cooldown <= 0)
+    {
+        input |= INPUT_FIRE;
+        bot->cooldown = FIRE_COOLDOWN;
+    }
+
+    bot->cooldown--;
+    return input;
+}
+
+static uint8_t policy_random(Bot *bot, int player)
+{
+    (void)player;
+    uint32_t x = bot_rand(bot);
+
+    if (x % 20 == 0)
+        bot->held = (uint8_t)((x >> 8) % 3); // none, left or right
+
+    uint8_t input = bot->held;
+    if ((x >> 16) % 10 == 0)
+        input |= INPUT_FIRE;
+    return input;
+}
+
+static uint8_t policy_greedy(Bot *bot, int player)
+{
+    int best = -1;
+    float best_distance = 0;
+
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        if (!targets[i].active)
+            continue;
+        float distance = fabsf((float)targets[i].x - player_x(player));
+        if (best < 0 || distance < best_distance)
+        {
+            best = i;
+            best_distance = distance;
+        }
+    }
+
+    if (best < 0)
+        return 0;
+    return aim_at(bot, player, targets[best].x);
+}
+
+// Where target i will be horizontally when a bullet fired now reaches it
+static float lead_x(int i)
+{
+    float climb = (shooter_y - 20) - targets[i].y;
+    float closing = BULLET_SPEED + targets[i].dy;
+    if (closing < 1)
+        closing = 1;
+
+    float x = targets[i].x + targets[i].dx * (climb / closing);
+
+    // Fold the prediction back into the field the way the walls would
+    float lo = 30, hi = world_width - 30;
+    for (int bounce = 0; bounce < 4 && (x < lo || x > hi); bounce++)
+        x = x < lo ? 2 * lo - x : 2 * hi - x;
+    return x;
+}
+
+static uint8_t policy_lead(Bot *bot, int player)
+{
+    int best = -1;
+    float best_x = 0, best_distance = 0;
+
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        if (!targets[i].active)
+            continue;
+        float x = lead_x(i);
+        float distance = fabsf(x - player_x(player));
+        if (best < 0 || distance < best_distance)
+        {
+            best = i;
+            best_x = x;
+            best_distance = distance;
+        }
+    }
+
+    if (best < 0)
+        return 0;
+    return aim_at(bot, player, best_x);
+}
+
+typedef uint8_t (*BotPolicyFn)(Bot *bot, int player);
+
+static const struct
+{
+    const char *name;
+    BotPolicyFn fn;
+} policies[BOT_POLICY_COUNT] = {
+    {"random", policy_random},
+    {"greedy", policy_greedy},
+    {"lead", policy_lead},
+};
+
+void bot_init(Bot *bot, BotPolicy policy, uint32_t seed)
+{
+    bot->policy = policy;
+    bot->rng = seed ? seed : 1;
+    bot->held = 0;
+    bot->cooldown = 0;
+}
+
+uint8_t bot_input(Bot *bot, int player)
+{
+    return policies[bot->policy].fn(bot, player);
+}
+
+const char *bot_policy_name(BotPolicy policy)
+{
+    return policies[policy].name;
+}
+
+bool bot_policy_from_name(const char *name, BotPolicy *policy)
+{
+    for (int i = 0; i < BOT_POLICY_COUNT; i++)
+    {
+        if (strcmp(name, policies[i].name) == 0)
+        {
+            *policy = (BotPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,33 @@
+// bot.h
+// Computer players. A bot looks at the game globals and returns the
+// input byte a human would have produced this tick, so it can drive
+// apply_input() anywhere a keyboard would.
+
+#ifndef BOT_H
+#define BOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    BOT_RANDOM, // wanders and sprays
+    BOT_GREEDY, // chases the nearest target and fires when under it
+    BOT_LEAD,   // aims where the target will be when the bullet gets there
+    BOT_POLICY_COUNT
+} BotPolicy;
+
+typedef struct
+{
+    BotPolicy policy;
+    uint32_t rng;
+    uint8_t held;
+    int cooldown; // ticks until the aiming bots fire again
+} Bot;
+
+void bot_init(Bot *bot, BotPolicy policy, uint32_t seed);
+uint8_t bot_input(Bot *bot, int player);
+const char *bot_policy_name(BotPolicy policy);
+bool bot_policy_from_name(const char *name, BotPolicy *policy);
+
+#endif
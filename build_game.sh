@@ -2,9 +2,39 @@
 echo "Building Shooter Game with Triangle & Ovals..."
 echo "==============================================="
 
+# Winsock on Windows, plain BSD sockets everywhere else
+NETLIBS=""
+case "$(uname -s)" in
+    MINGW*|MSYS*|CYGWIN*) NETLIBS="-lws2_32" ;;
+    Linux*) NETLIBS="-lrt" ;; # shm_open for the telemetry feed on older glibc
+esac
+
+# FIXED_POINT=1 ./build_game.sh builds the simulation with integer entities
+SIMFLAGS=""
+if [ "$FIXED_POINT" = "1" ]; then
+    SIMFLAGS="-DGAME_FIXED_POINT"
+fi
+
+# ALLOC_TRACKING=1 ./build_game.sh counts heap allocations per frame (alloctrack.h)
+DEBUGFLAGS=""
+if [ "$ALLOC_TRACKING" = "1" ]; then
+    DEBUGFLAGS="-DALLOC_TRACKING"
+fi
+
+# Pack the font into the executable (assets_data.c is generated)
+echo "Packing assets..."
+gcc assetpack.c -o assetpack && ./assetpack assets_data.c font=arial.ttf
+if [ $? -ne 0 ]; then
+    echo "✗ Asset packing failed!"
+    exit 1
+fi
+
+# Compile the sample level (waves.txt -> waves.lvl)
+gcc levelc.c -o levelc && ./levelc waves.txt waves.lvl
+
 # Compile
 echo "Compiling..."
-gcc shooter.c -o shooter.exe -lSDL2 -lSDL2_ttf -lm
+gcc $SIMFLAGS $DEBUGFLAGS shooter.c game.c level.c snapshot.c net.c telemetry.c assets.c assets_data.c render_queue.c alloctrack.c audio.c -o shooter.exe -lSDL2 -lSDL2_ttf -lm $NETLIBS
 
 if [ $? -eq 0 ]; then
     echo "✓ Compilation successful!"
@@ -12,6 +42,21 @@ else
     echo "✗ Compilation failed!"
     exit 1
 fi
+gcc -O2 audiotest.c audio.c -o audiotest -lSDL2 -lm && echo "✓ Built audiotest"
+
+# Headless tools (need fork, so not on Windows)
+if [ "$NETLIBS" != "-lws2_32" ]; then
+    gcc nettest.c game.c snapshot.c net.c -o nettest -lm && echo "✓ Built nettest"
+    gcc -O2 selfplay.c bot.c game.c level.c -o selfplay -lm && echo "✓ Built selfplay"
+    gcc leveltest.c game.c level.c -o leveltest -lm && echo "✓ Built leveltest"
+    gcc -DGAME_FIXED_POINT leveltest.c game.c level.c -o leveltest_fixed -lm && echo "✓ Built leveltest_fixed"
+    gcc spectate.c telemetry.c game.c -o spectate -lm $NETLIBS && echo "✓ Built spectate"
+    gcc -O2 simbench.c game.c snapshot.c -o simbench -lm && echo "✓ Built simbench"
+    gcc -O2 -DGAME_FIXED_POINT simbench.c game.c snapshot.c -o simbench_fixed -lm && echo "✓ Built simbench_fixed"
+    if [ "$(uname -s)" = "Linux" ]; then
+        gcc -O2 gymd.c gym.c game.c snapshot.c -o gymd -lm -lrt && echo "✓ Built gymd"
+    fi
+fi
 
 # Copy DLLs
 echo "Copying DLL files..."
@@ -23,16 +68,6 @@ for dll in "${DLLS[@]}"; do
     fi
 done
 
-# Copy font
-echo "Copying font..."
-if [ -f "/c/Windows/Fonts/arial.ttf" ]; then
-    cp "/c/Windows/Fonts/arial.ttf" .
-    echo "✓ Copied arial.ttf"
-else
-    echo "⚠ Could not find arial.ttf, trying alternatives..."
-    touch arial.ttf  # Create empty file as placeholder
-fi
-
 echo ""
 echo "Game built successfully!"
 echo "Run: ./shooter.exe"
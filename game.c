@@ -0,0 +1,902 @@
+// game.c
+// Simulation half of the shooter: targets, bullets, collisions and score.
+// The SDL front end (shooter.c) drives these functions once per frame.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "game.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Working type for positions and speeds inside the kernels
+#ifdef GAME_FIXED_POINT
+typedef int coord_t;
+#define coord_abs(v) abs(v)
+#else
+typedef float coord_t;
+#define coord_abs(v) fabsf(v)
+#endif
+
+// Kernel bodies are forced inline into each specialized loop, so the
+// constant arguments each loop passes fold away
+#ifdef __GNUC__
+#define KERNEL static inline __attribute__((always_inline))
+#else
+#define KERNEL static inline
+#endif
+
+// Index of the lowest set bit of a non-zero mask
+#ifdef __GNUC__
+#define lowest_bit(mask) __builtin_ctzll(mask)
+#else
+static int lowest_bit(uint64_t mask)
+{
+    int n = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        n++;
+    }
+    return n;
+}
+#endif
+
+// The spatial grid keeps one bit per target and per bullet
+#if MAX_TARGETS > 32 || MAX_BULLETS > 64
+#error "SpatialGrid masks are too narrow for MAX_TARGETS or MAX_BULLETS"
+#endif
+
+// Global arrays
+Target targets[MAX_TARGETS];
+Bullet bullets[MAX_BULLETS];
+
+// Game state
+int shooter_x, shooter_y;
+int partner_x;
+int player_count = 1;
+int bullets_used = 0;
+int bullets_remaining = MAX_BULLETS;
+int score = 0;
+int targets_killed = 0;
+int targets_total = TARGET_COUNT;
+int targets_in_use = 0;
+bool game_running = true;
+bool game_won = false;
+bool game_lost = false;
+
+uint32_t game_tick = 0;
+uint32_t game_rng = 1;
+
+GameEventHook game_event_hook = NULL;
+
+GameLevel game_level = {NULL, 0};
+uint32_t level_cursor = 0;
+
+int world_width = SCREEN_WIDTH;
+bool far_target_lod = false;
+int targets_slow = 0;
+uint64_t collision_pairs = 0;
+
+static void emit(GameEventType type, int index)
+{
+    if (game_event_hook)
+        game_event_hook(type, index);
+}
+
+void game_seed(uint32_t seed)
+{
+    // xorshift gets stuck on zero
+    game_rng = seed ? seed : 1;
+}
+
+int game_rand()
+{
+    // xorshift32 - small, fast and identical on every platform
+    uint32_t x = game_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    game_rng = x;
+    return (int)(x >> 1);
+}
+
+void init_game()
+{
+    // Initialize shooter position (center bottom)
+    shooter_x = world_width / 2;
+    shooter_y = SCREEN_HEIGHT - 120;
+    if (player_count > 1)
+    {
+        // Co-op: split the shooters either side of center
+        shooter_x = world_width / 3;
+        partner_x = world_width * 2 / 3;
+    }
+
+    // Reset counters
+    bullets_used = 0;
+    bullets_remaining = MAX_BULLETS;
+    score = 0;
+    targets_killed = 0;
+    game_won = false;
+    game_lost = false;
+    game_tick = 0;
+    targets_slow = 0;
+    collision_pairs = 0;
+
+    // Clear bullets
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        bullets[i].active = false;
+    }
+
+    // Empty the target pool
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        targets[i].active = false;
+    }
+    targets_in_use = 0;
+    level_cursor = 0;
+
+    if (game_level.count > 0)
+    {
+        // Scripted level: anything due at tick 0 appears now, the rest
+        // streams in from update_game()
+        targets_total = (int)game_level.count;
+        spawn_due_targets();
+        return;
+    }
+
+    // Create targets at random positions
+    targets_total = TARGET_COUNT;
+    for (int i = 0; i < TARGET_COUNT; i++)
+    {
+        spawn_target(i);
+    }
+    targets_in_use = TARGET_COUNT;
+}
+
+void reset_game()
+{
+    init_game();
+}
+
+void spawn_target(int index)
+{
+    // Position targets randomly in upper half of screen
+    targets[index].x = 50 + (game_rand() % (world_width - 100));
+    targets[index].y = 50 + (game_rand() % 200);
+
+    // Random movement direction
+    targets[index].dx = (game_rand() % 5) - 2;
+    targets[index].dy = (game_rand() % 5) - 2;
+
+    targets[index].active = true;
+    targets[index].hits = 0;
+    targets[index].hit_points = 2;
+    targets[index].behaviour = BEHAVIOUR_BOUNCE;
+}
+
+void spawn_due_targets()
+{
+    while (level_cursor < game_level.count)
+    {
+        // Record layout from level.h: tick u32, x i16, y i16, dx i8, dy i8,
+        // hit points u8, behaviour u8, all little endian
+        const uint8_t *r = game_level.records + (size_t)level_cursor * LEVEL_RECORD_SIZE;
+        uint32_t tick = r[0] | (r[1] << 8) | (r[2] << 16) | ((uint32_t)r[3] << 24);
+        if (tick > game_tick)
+            break;
+
+        // A full pool holds the spawn back until a slot frees up
+        int slot = 0;
+        while (slot < MAX_TARGETS && targets[slot].active)
+            slot++;
+        if (slot == MAX_TARGETS)
+            break;
+
+        Target *t = &targets[slot];
+        t->x = (int16_t)(r[4] | (r[5] << 8));
+        if (t->x > world_width - 30)
+            t->x = world_width - 30; // written for a wider world than this one
+        t->y = (int16_t)(r[6] | (r[7] << 8));
+        t->dx = (int8_t)r[8];
+        t->dy = (int8_t)r[9];
+        // levelc writes nothing out of range, but any file can be handed
+        // in. Clamp so the fixed build's 4-bit fields cannot wrap.
+        t->hit_points = r[10] < 1 ? 1 : r[10] > TARGET_MAX_HIT_POINTS ? TARGET_MAX_HIT_POINTS : r[10];
+        t->behaviour = r[11] < BEHAVIOUR_COUNT ? r[11] : BEHAVIOUR_BOUNCE;
+        t->hits = 0;
+        t->active = true;
+
+        if (slot >= targets_in_use)
+            targets_in_use = slot + 1;
+        level_cursor++;
+    }
+}
+
+static int clamp_shooter(int x)
+{
+    if (x < 40)
+        return 40;
+    if (x > world_width - 40)
+        return world_width - 40;
+    return x;
+}
+
+void move_shooter(int dx)
+{
+    shooter_x = clamp_shooter(shooter_x + dx);
+}
+
+void apply_input(int player, uint8_t input)
+{
+    int *x = player == 0 ? &shooter_x : &partner_x;
+
+    if (input & INPUT_LEFT)
+        *x = clamp_shooter(*x - SHOOTER_SPEED);
+    if (input & INPUT_RIGHT)
+        *x = clamp_shooter(*x + SHOOTER_SPEED);
+
+    if ((input & INPUT_FIRE) && !game_won && !game_lost)
+        shoot_bullet_from(*x);
+
+    if ((input & INPUT_RESET) && (game_won || game_lost))
+        reset_game();
+}
+
+void shoot_bullet()
+{
+    shoot_bullet_from(shooter_x);
+}
+
+void shoot_bullet_from(int x)
+{
+    if (bullets_remaining <= 0)
+        return;
+
+    // Find first inactive bullet
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        if (!bullets[i].active)
+        {
+            bullets[i].x = x;
+            bullets[i].y = shooter_y - 20; // Start from tip of triangle
+            bullets[i].active = true;
+
+            bullets_used++;
+            bullets_remaining--;
+            emit(GAME_EVENT_SHOT, i);
+            break;
+        }
+    }
+}
+
+void update_game()
+{
+    if (game_won || game_lost)
+        return;
+
+    game_tick++;
+
+    // The kernels for this tick are picked here, once. A target reaching
+    // the shooter ends the game but the tick still plays out in full.
+    GameMode mode = game_mode();
+
+    spawn_due_targets();
+    step_bullets(bullets, MAX_BULLETS);
+    if (far_target_lod && mode == GAME_MODE_NORMAL)
+    {
+        step_targets_lod();
+    }
+    else
+    {
+        // Everyone steps every tick, and all targets charge when the
+        // bullets run out
+        step_targets_mode(mode, targets, targets_in_use);
+        targets_slow = 0;
+    }
+
+    // Check collisions
+    collide_mode(mode, bullets, MAX_BULLETS, targets, targets_in_use);
+
+    // Dead slots at the top of the pool no longer need scanning
+    while (targets_in_use > 0 && !targets[targets_in_use - 1].active)
+        targets_in_use--;
+
+    // Check win condition
+    if (targets_killed >= targets_total)
+    {
+        game_won = true;
+        score = calculate_score();
+    }
+
+    // Check lose condition (out of bullets)
+    if (bullets_remaining <= 0)
+    {
+        // Check if any bullets are still active
+        bool any_bullets_active = false;
+        for (int i = 0; i < MAX_BULLETS; i++)
+        {
+            if (bullets[i].active)
+            {
+                any_bullets_active = true;
+                break;
+            }
+        }
+
+        // If no bullets active and not all targets killed, game over
+        if (!any_bullets_active && targets_killed < targets_total)
+        {
+            game_lost = true;
+        }
+    }
+
+    if (game_won)
+        emit(GAME_EVENT_WIN, -1);
+    else if (game_lost)
+        emit(GAME_EVENT_LOSE, -1);
+}
+
+void step_bullets(Bullet *list, int count)
+{
+    // Update bullets - move upward, and remove them once off screen.
+    // Written without branches so the loop vectorizes; inactive bullets
+    // are stored back unchanged.
+    for (int i = 0; i < count; i++)
+    {
+        bool active = list[i].active;
+        coord_t y = list[i].y - BULLET_SPEED;
+        list[i].y = active ? y : list[i].y;
+        list[i].active = active && y >= 0;
+    }
+}
+
+GameMode game_mode()
+{
+    if (game_won || game_lost)
+        return GAME_MODE_OVER;
+    return bullets_remaining <= 0 ? GAME_MODE_ATTACK : GAME_MODE_NORMAL;
+}
+
+// Moves one target by steps ticks' worth of its speed. Always inlined, so
+// each caller passes constant steps and attacking and gets a loop with
+// those branches folded away; what is left per target is written as
+// selects. Worked on in locals and written back once, which keeps the
+// packed fixed-point fields out of each other's way. Returns true if the
+// target reached the shooter.
+KERNEL bool step_target(Target *t, int steps, int right_wall, bool attacking)
+{
+    // Move target
+    coord_t dx = t->dx;
+    coord_t dy = t->dy;
+    coord_t x = t->x + dx * steps;
+    coord_t y = t->y + dy * steps;
+
+    // Bounce off walls (divers keep going at the bottom)
+    bool bottom = y > SCREEN_HEIGHT - 150 && t->behaviour != BEHAVIOUR_DIVE; // Adjusted bottom boundary
+    dx = (x < 30 || x > right_wall) ? -dx : dx;
+    dy = (y < 30 || bottom) ? -dy : dy;
+
+    // If out of bullets, targets attack (move toward shooter)
+    if (attacking)
+    {
+        // Move down faster
+        y += 3;
+    }
+
+    // Move horizontally toward the nearest shooter
+    if (attacking || t->behaviour == BEHAVIOUR_CHASE)
+    {
+        int prey_x = shooter_x;
+        if (player_count > 1)
+            prey_x = coord_abs(x - partner_x) < coord_abs(x - shooter_x) ? partner_x : shooter_x;
+        dx = x < prey_x ? 2 : x > prey_x ? -2 : dx;
+    }
+
+    t->x = x;
+    t->y = y;
+    t->dx = dx;
+    t->dy = dy;
+
+    // Check if target reached shooter (game over)
+    return (attacking || t->behaviour == BEHAVIOUR_DIVE) && y > SCREEN_HEIGHT - 130;
+}
+
+#ifdef __SSE2__
+// step_target() for four targets at once, in 32-bit lanes of coord_t.
+// Compares give all-ones lanes, and every choice is a select, so there is
+// no branch left. The compiler will not do this itself: the byte fields
+// inside each record defeat its load permutations, and the fixed build's
+// bitfields its loads altogether.
+#ifdef GAME_FIXED_POINT
+typedef __m128i coord4_t;
+#define coord4_set(v) _mm_set1_epi32(v)
+#define coord4_mask(m) (m)
+#define coord4_add _mm_add_epi32
+#define coord4_sub _mm_sub_epi32
+#define coord4_lt _mm_cmplt_epi32
+#define coord4_gt _mm_cmpgt_epi32
+#define coord4_and _mm_and_si128
+#define coord4_andnot _mm_andnot_si128
+#define coord4_or _mm_or_si128
+#define coord4_movemask(m) _mm_movemask_ps(_mm_castsi128_ps(m))
+
+static inline coord4_t coord4_ne(coord4_t a, coord4_t b)
+{
+    return _mm_xor_si128(_mm_cmpeq_epi32(a, b), _mm_set1_epi32(-1));
+}
+
+static inline coord4_t coord4_neg(coord4_t v)
+{
+    return _mm_sub_epi32(_mm_setzero_si128(), v);
+}
+
+static inline coord4_t coord4_abs(coord4_t v)
+{
+    __m128i sign = _mm_srai_epi32(v, 31);
+    return _mm_sub_epi32(_mm_xor_si128(v, sign), sign);
+}
+
+// Four 8-byte records are two loads; gather each record's low and high
+// halves into lanes, then sign-extend the fields out of them
+_Static_assert(sizeof(Target) == 8 && offsetof(Target, y) == 2 && offsetof(Target, dx) == 4 &&
+                   offsetof(Target, dy) == 5,
+               "step_four_targets unpacks this layout");
+
+static inline void load_four(const Target *t, coord4_t *x, coord4_t *y, coord4_t *dx, coord4_t *dy,
+                             __m128i *flags)
+{
+    __m128 a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&t[0]));
+    __m128 b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)&t[2]));
+    __m128i low = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+    __m128i high = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    *x = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+    *y = _mm_srai_epi32(low, 16);
+    *dx = _mm_srai_epi32(_mm_slli_epi32(high, 24), 24);
+    *dy = _mm_srai_epi32(_mm_slli_epi32(high, 16), 24);
+    *flags = high;
+}
+
+// Truncates back to int16 and int8 the way the scalar stores do, and
+// puts the bitfield bytes back untouched
+static inline void store_four(Target *t, coord4_t x, coord4_t y, coord4_t dx, coord4_t dy, __m128i flags)
+{
+    __m128i low = _mm_or_si128(_mm_and_si128(x, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(y, 16));
+    __m128i high = _mm_or_si128(_mm_and_si128(dx, _mm_set1_epi32(0xFF)),
+                                _mm_slli_epi32(_mm_and_si128(dy, _mm_set1_epi32(0xFF)), 8));
+    high = _mm_or_si128(high, _mm_andnot_si128(_mm_set1_epi32(0xFFFF), flags));
+    _mm_storeu_si128((__m128i *)&t[0], _mm_unpacklo_epi32(low, high));
+    _mm_storeu_si128((__m128i *)&t[2], _mm_unpackhi_epi32(low, high));
+}
+#else
+typedef __m128 coord4_t;
+#define coord4_set(v) _mm_set1_ps((float)(v))
+#define coord4_mask(m) _mm_castsi128_ps(m)
+#define coord4_add _mm_add_ps
+#define coord4_sub _mm_sub_ps
+#define coord4_lt _mm_cmplt_ps
+#define coord4_gt _mm_cmpgt_ps
+#define coord4_ne _mm_cmpneq_ps
+#define coord4_and _mm_and_ps
+#define coord4_andnot _mm_andnot_ps
+#define coord4_or _mm_or_ps
+#define coord4_movemask _mm_movemask_ps
+
+// Flips the sign bit like unary minus, so 0 becomes -0 as it does there
+static inline coord4_t coord4_neg(coord4_t v)
+{
+    return _mm_xor_ps(v, _mm_set1_ps(-0.0f));
+}
+
+static inline coord4_t coord4_abs(coord4_t v)
+{
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+// x, y, dx and dy lead each record: four loads and a transpose
+_Static_assert(offsetof(Target, x) == 0 && offsetof(Target, dy) == 12, "step_four_targets loads x..dy as one vector");
+
+static inline void load_four(const Target *t, coord4_t *x, coord4_t *y, coord4_t *dx, coord4_t *dy,
+                             __m128i *flags)
+{
+    __m128 a = _mm_loadu_ps(&t[0].x), b = _mm_loadu_ps(&t[1].x);
+    __m128 c = _mm_loadu_ps(&t[2].x), d = _mm_loadu_ps(&t[3].x);
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    *x = a;
+    *y = b;
+    *dx = c;
+    *dy = d;
+    *flags = _mm_setzero_si128();
+}
+
+static inline void store_four(Target *t, coord4_t x, coord4_t y, coord4_t dx, coord4_t dy, __m128i flags)
+{
+    (void)flags;
+    _MM_TRANSPOSE4_PS(x, y, dx, dy);
+    _mm_storeu_ps(&t[0].x, x);
+    _mm_storeu_ps(&t[1].x, y);
+    _mm_storeu_ps(&t[2].x, dx);
+    _mm_storeu_ps(&t[3].x, dy);
+}
+#endif
+
+static inline coord4_t coord4_select(coord4_t mask, coord4_t a, coord4_t b)
+{
+    return coord4_or(coord4_and(mask, a), coord4_andnot(mask, b));
+}
+
+// Same operations in the same order as step_target(), so the results
+// match it bit for bit. Inactive targets are stored back unchanged.
+// Returns a bit per target that reached the shooter.
+KERNEL int step_four_targets(Target *t, int right_wall, bool attacking)
+{
+    coord4_t x, y, dx, dy;
+    __m128i flags;
+    load_four(t, &x, &y, &dx, &dy, &flags);
+    coord4_t old_x = x, old_y = y, old_dx = dx, old_dy = dy;
+
+    __m128i behaviour = _mm_set_epi32(t[3].behaviour, t[2].behaviour, t[1].behaviour, t[0].behaviour);
+    __m128i active_flags = _mm_set_epi32(t[3].active, t[2].active, t[1].active, t[0].active);
+    coord4_t active = coord4_mask(_mm_cmpgt_epi32(active_flags, _mm_setzero_si128()));
+    coord4_t chase = coord4_mask(_mm_cmpeq_epi32(behaviour, _mm_set1_epi32(BEHAVIOUR_CHASE)));
+    coord4_t dive = coord4_mask(_mm_cmpeq_epi32(behaviour, _mm_set1_epi32(BEHAVIOUR_DIVE)));
+    coord4_t all = coord4_mask(_mm_set1_epi32(-1));
+
+    x = coord4_add(x, dx);
+    y = coord4_add(y, dy);
+
+    coord4_t bottom = coord4_andnot(dive, coord4_gt(y, coord4_set(SCREEN_HEIGHT - 150)));
+    coord4_t flip_x = coord4_or(coord4_lt(x, coord4_set(30)), coord4_gt(x, coord4_set(right_wall)));
+    coord4_t flip_y = coord4_or(coord4_lt(y, coord4_set(30)), bottom);
+    dx = coord4_select(flip_x, coord4_neg(dx), dx);
+    dy = coord4_select(flip_y, coord4_neg(dy), dy);
+
+    if (attacking)
+        y = coord4_add(y, coord4_set(3));
+
+    coord4_t shooter = coord4_set(shooter_x);
+    coord4_t partner = coord4_set(partner_x);
+    coord4_t partner_closer = coord4_lt(coord4_abs(coord4_sub(x, partner)), coord4_abs(coord4_sub(x, shooter)));
+    partner_closer = coord4_and(partner_closer, coord4_mask(_mm_set1_epi32(-(player_count > 1))));
+    coord4_t prey = coord4_select(partner_closer, partner, shooter);
+    coord4_t steer = coord4_and(attacking ? all : chase, coord4_ne(x, prey));
+    coord4_t toward = coord4_select(coord4_lt(x, prey), coord4_set(2), coord4_set(-2));
+    dx = coord4_select(steer, toward, dx);
+
+    coord4_t reached = coord4_and(attacking ? all : dive, coord4_gt(y, coord4_set(SCREEN_HEIGHT - 130)));
+    reached = coord4_and(reached, active);
+
+    store_four(t, coord4_select(active, x, old_x), coord4_select(active, y, old_y),
+               coord4_select(active, dx, old_dx), coord4_select(active, dy, old_dy), flags);
+    return coord4_movemask(reached);
+}
+#endif
+
+// One loop per mode, each with attacking fixed. With SSE2 the targets go
+// four at a time through step_four_targets(), which steps every slot and
+// keeps the result where the target is active; the last few, and every
+// target elsewhere, go one at a time.
+KERNEL void step_targets_kernel(Target *list, int count, bool attacking)
+{
+    int right_wall = world_width - 30;
+    bool reached = false;
+    int i = 0;
+#ifdef __SSE2__
+    for (; i + 4 <= count; i += 4)
+        reached |= step_four_targets(&list[i], right_wall, attacking) != 0;
+#endif
+    for (; i < count; i++)
+    {
+        if (list[i].active)
+            reached |= step_target(&list[i], 1, right_wall, attacking);
+    }
+    if (reached)
+        game_lost = true;
+}
+
+static void step_targets_normal(Target *list, int count)
+{
+    step_targets_kernel(list, count, false);
+}
+
+static void step_targets_attack(Target *list, int count)
+{
+    step_targets_kernel(list, count, true);
+}
+
+void step_targets_mode(GameMode mode, Target *list, int count)
+{
+    switch (mode)
+    {
+    case GAME_MODE_NORMAL:
+        step_targets_normal(list, count);
+        break;
+    case GAME_MODE_ATTACK:
+        step_targets_attack(list, count);
+        break;
+    case GAME_MODE_OVER:
+        break; // nothing moves once the game is decided
+    }
+}
+
+void step_targets(Target *list, int count)
+{
+    step_targets_mode(game_mode(), list, count);
+}
+
+// Far from every shooter, and no bullet in or rising into its columns
+static bool target_is_far(const SpatialGrid *grid, const Target *t)
+{
+    if (coord_abs(t->x - shooter_x) <= LOD_DISTANCE)
+        return false;
+    if (player_count > 1 && coord_abs(t->x - partner_x) <= LOD_DISTANCE)
+        return false;
+
+    uint32_t target_mask;
+    uint64_t bullet_mask;
+    grid_query(grid, (int)t->x - GRID_CELL, 0, (int)t->x + GRID_CELL, SCREEN_HEIGHT,
+               &target_mask, &bullet_mask);
+    return bullet_mask == 0;
+}
+
+void step_targets_lod()
+{
+    static SpatialGrid grid;
+    grid_build(&grid);
+
+    // Far targets take turns, so a quarter of them move on any one tick.
+    // Only used in normal mode; attacking targets all step every tick.
+    bool reached = false;
+    targets_slow = 0;
+    for (int i = 0; i < targets_in_use; i++)
+    {
+        if (!targets[i].active)
+            continue;
+
+        if (!target_is_far(&grid, &targets[i]))
+        {
+            reached |= step_target(&targets[i], 1, world_width - 30, false);
+            continue;
+        }
+
+        targets_slow++;
+        if ((game_tick + (uint32_t)i) % LOD_INTERVAL == 0)
+            reached |= step_target(&targets[i], LOD_INTERVAL, world_width - 30, false);
+    }
+    if (reached)
+        game_lost = true;
+}
+
+static int grid_column(const SpatialGrid *grid, int x)
+{
+    int c = x / GRID_CELL;
+    return c < 0 ? 0 : c >= grid->columns ? grid->columns - 1 : c;
+}
+
+static int grid_row(int y)
+{
+    int r = y / GRID_CELL;
+    return r < 0 ? 0 : r >= GRID_ROWS ? GRID_ROWS - 1 : r;
+}
+
+void grid_build(SpatialGrid *grid)
+{
+    grid->columns = (world_width + GRID_CELL - 1) / GRID_CELL;
+    if (grid->columns > GRID_COLUMNS)
+        grid->columns = GRID_COLUMNS;
+
+    for (int r = 0; r < GRID_ROWS; r++)
+    {
+        for (int c = 0; c < grid->columns; c++)
+        {
+            grid->cells[r][c].targets = 0;
+            grid->cells[r][c].bullets = 0;
+        }
+    }
+
+    // Anything off the edge of the world goes in the nearest cell
+    for (int i = 0; i < targets_in_use; i++)
+    {
+        if (targets[i].active)
+            grid->cells[grid_row((int)targets[i].y)][grid_column(grid, (int)targets[i].x)].targets |= 1u << i;
+    }
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        if (bullets[i].active)
+            grid->cells[grid_row((int)bullets[i].y)][grid_column(grid, (int)bullets[i].x)].bullets |= 1ull << i;
+    }
+}
+
+void grid_query(const SpatialGrid *grid, int left, int top, int right, int bottom,
+                uint32_t *target_mask, uint64_t *bullet_mask)
+{
+    uint32_t t = 0;
+    uint64_t b = 0;
+    int c0 = grid_column(grid, left), c1 = grid_column(grid, right);
+    int r0 = grid_row(top), r1 = grid_row(bottom);
+
+    for (int r = r0; r <= r1; r++)
+    {
+        for (int c = c0; c <= c1; c++)
+        {
+            t |= grid->cells[r][c].targets;
+            b |= grid->cells[r][c].bullets;
+        }
+    }
+    *target_mask = t;
+    *bullet_mask = b;
+}
+
+#define HIT_RADIUS 25
+
+// Oval collision detection (approximate with circle for simplicity)
+static bool in_hit_radius(const Bullet *bullet, const Target *target)
+{
+#ifdef GAME_FIXED_POINT
+    // Squared distance; the same answer as the float test for any
+    // whole-pixel positions on screen
+    int32_t dx = bullet->x - target->x;
+    int32_t dy = bullet->y - target->y;
+    return dx * dx + dy * dy < HIT_RADIUS * HIT_RADIUS;
+#else
+    // Calculate distance between bullet and target center
+    float dx = bullet->x - target->x;
+    float dy = bullet->y - target->y;
+    float distance = sqrtf(dx * dx + dy * dy);
+    return distance < HIT_RADIUS; // Collision radius for oval
+#endif
+}
+
+void check_collisions()
+{
+    collide(bullets, MAX_BULLETS, targets, targets_in_use);
+}
+
+// Targets per tile and bullets per chunk: one bit each in a uint64_t
+#define COLLIDE_TILE 64
+
+// The live targets in the tile the bullet is within range of, as a mask;
+// the lowest bit is the one it hits. A mostly live tile is tested straight
+// through with no branches. A sparse one is only tested at its live bits
+// and stops at the first hit, so the mask then holds just that one. Adds
+// the live targets tested to *pairs.
+KERNEL uint64_t tile_hits(const Bullet *bullet, const Target *tile, int tile_count, uint64_t live, int live_count,
+                          uint64_t *pairs)
+{
+    if (live_count * 4 < tile_count)
+    {
+        for (uint64_t m = live; m; m &= m - 1)
+        {
+            int j = lowest_bit(m);
+            (*pairs)++;
+            if (in_hit_radius(bullet, &tile[j]))
+                return (uint64_t)1 << j;
+        }
+        return 0;
+    }
+
+    uint64_t hits = 0, bit = 1;
+    for (int j = 0; j < tile_count; j++, bit <<= 1)
+        hits |= in_hit_radius(bullet, &tile[j]) ? bit : 0;
+    *pairs += live_count;
+    return hits & live;
+}
+
+// Normal and attack play collide the same way, so they share this kernel.
+// Targets are taken a tile at a time: a mask of the live ones and the
+// band they cover vertically. Bullets are then gathered a chunk at a time
+// into a mask of the live ones that can reach the band, and each of those
+// is tested against the tile. The tile stays in cache while the bullets
+// stream past, and bullets in the empty sky above the targets are not
+// tested at all.
+//
+// A bullet only reaches a tile after missing every earlier one, and finds
+// its targets as the earlier bullets left them, so it hits the same target
+// it would testing all of them in order. With more than one tile (simbench
+// only; the game's pool is one) hits are reported tile by tile.
+static void collide_live(Bullet *bullet_list, int bullet_count, Target *target_list, int target_count)
+{
+    uint64_t pairs = 0;
+    for (int base = 0; base < target_count; base += COLLIDE_TILE)
+    {
+        Target *tile = target_list + base;
+        int tile_count = target_count - base < COLLIDE_TILE ? target_count - base : COLLIDE_TILE;
+
+        uint64_t live = 0;
+        int live_count = 0;
+        coord_t top = 0, bottom = 0;
+        for (int j = 0; j < tile_count; j++)
+        {
+            if (!tile[j].active)
+                continue;
+            coord_t y = tile[j].y;
+            top = live_count && top < y ? top : y;
+            bottom = live_count && bottom > y ? bottom : y;
+            live |= (uint64_t)1 << j;
+            live_count++;
+        }
+
+        for (int first = 0; first < bullet_count && live; first += 64)
+        {
+            int chunk = bullet_count - first < 64 ? bullet_count - first : 64;
+
+            // Out of the band means out of range of every target in it.
+            // The subtractions are the ones in_hit_radius() makes, so this
+            // never rejects a bullet it would accept.
+            uint64_t candidates = 0;
+            for (int k = 0; k < chunk; k++)
+            {
+                const Bullet *b = &bullet_list[first + k];
+                bool in_band = (b->y - bottom < HIT_RADIUS) & (top - b->y < HIT_RADIUS);
+                candidates |= (uint64_t)(b->active & in_band) << k;
+            }
+
+            for (; candidates && live; candidates &= candidates - 1)
+            {
+                int i = first + lowest_bit(candidates);
+                uint64_t hits = tile_hits(&bullet_list[i], tile, tile_count, live, live_count, &pairs);
+                if (!hits)
+                    continue;
+
+                int j = lowest_bit(hits);
+                bullet_list[i].active = false;
+                tile[j].hits++;
+                emit(GAME_EVENT_HIT, base + j);
+
+                if (tile[j].hits >= tile[j].hit_points)
+                {
+                    tile[j].active = false;
+                    live &= ~((uint64_t)1 << j);
+                    live_count--;
+                    targets_killed++;
+                    score += 10; // Base points for killing a target
+                    emit(GAME_EVENT_KILL, base + j);
+                }
+            }
+        }
+    }
+    collision_pairs = pairs;
+}
+
+void collide_mode(GameMode mode, Bullet *bullet_list, int bullet_count, Target *target_list, int target_count)
+{
+    if (mode != GAME_MODE_OVER)
+        collide_live(bullet_list, bullet_count, target_list, target_count);
+    else
+        collision_pairs = 0;
+}
+
+void collide(Bullet *bullet_list, int bullet_count, Target *target_list, int target_count)
+{
+    collide_mode(game_mode(), bullet_list, bullet_count, target_list, target_count);
+}
+
+int calculate_score()
+{
+    // As per requirements: 20 bullets = 100 score, 50 bullets = 0 score
+    if (bullets_used <= 20)
+    {
+        return 100;
+    }
+
+    if (bullets_used >= 50)
+    {
+        return 0;
+    }
+
+    // Linear decrease: 100 points for 20 bullets, 0 points for 50 bullets
+    int bullets_over_minimum = bullets_used - 20;
+
+    // Calculate score (100 - (excess bullets * 100 / 30))
+    int calculated_score = 100 - (bullets_over_minimum * 100 / 30);
+
+    if (calculated_score < 0)
+        calculated_score = 0;
+    if (calculated_score > 100)
+        calculated_score = 100;
+
+    return calculated_score;
+}
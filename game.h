@@ -0,0 +1,209 @@
+// game.h
+// Game rules and simulation state shared by the SDL front end and the
+// headless tools. Nothing in here touches SDL, so the simulation can be
+// stepped, saved and restored without a window.
+
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Game Constants
+#define SCREEN_WIDTH 1500
+#define SCREEN_HEIGHT 750
+#define TARGET_COUNT 10 // targets in the built-in random level
+#define MAX_TARGETS 32  // live targets at once; scripted levels queue the rest
+#define MAX_BULLETS 50
+#define SHOOTER_SPEED 5
+#define BULLET_SPEED 10
+#define TARGET_SPEED 2
+#define MAX_PLAYERS 2
+#define MAX_WORLD_SCREENS 8 // widest play field, in screens
+
+// Per-tick player input, one byte per player. Movement bits are held
+// state, FIRE and RESET are presses that happened during the tick.
+#define INPUT_LEFT 0x01
+#define INPUT_RIGHT 0x02
+#define INPUT_FIRE 0x04
+#define INPUT_RESET 0x08
+
+// Things that happen during a tick, for anyone listening (telemetry,
+// sound). index is the bullet for shots and the target for hits/kills.
+typedef enum
+{
+    GAME_EVENT_SHOT,
+    GAME_EVENT_HIT,
+    GAME_EVENT_KILL,
+    GAME_EVENT_WIN,
+    GAME_EVENT_LOSE
+} GameEventType;
+
+typedef void (*GameEventHook)(GameEventType type, int index);
+
+// What a tick does, which decides the kernels it runs: normal play,
+// targets attacking once the bullets are gone, or nothing once the game
+// is won or lost
+typedef enum
+{
+    GAME_MODE_NORMAL,
+    GAME_MODE_ATTACK,
+    GAME_MODE_OVER
+} GameMode;
+
+// How a target moves (scripted levels choose; random targets bounce)
+#define BEHAVIOUR_BOUNCE 0 // straight lines, bouncing off the walls
+#define BEHAVIOUR_CHASE 1  // bounces vertically, steers toward the nearest shooter
+#define BEHAVIOUR_DIVE 2   // like bounce, but does not turn back at the bottom
+#define BEHAVIOUR_COUNT 3
+
+// Most hits a target can take; the fixed build keeps hit points in 4 bits
+#define TARGET_MAX_HIT_POINTS 15
+
+// Game Structures
+#ifdef GAME_FIXED_POINT
+// Every position and speed in the game is a whole number of pixels, so
+// the fixed-point build stores them as plain integers: int16 positions,
+// int8 speeds, and hits/active folded into one byte. Results match the
+// float build bit for bit (snapshots are interchangeable) and a target
+// takes 8 bytes instead of 24.
+typedef struct
+{
+    int16_t x, y;
+    int8_t dx, dy;
+    uint8_t active : 1;
+    uint8_t hits : 4;
+    uint8_t hit_points : 4; // hits needed to kill
+    uint8_t behaviour : 4;
+} Target;
+
+typedef struct
+{
+    int16_t x, y;
+    uint8_t active;
+} Bullet;
+#else
+typedef struct
+{
+    float x, y;
+    float dx, dy;
+    bool active;
+    uint8_t hit_points; // hits needed to kill
+    uint8_t behaviour;
+    int hits;
+} Target;
+
+typedef struct
+{
+    float x, y;
+    bool active;
+} Bullet;
+#endif
+
+// A scripted level: spawn records sorted by tick, in the binary format
+// described in level.h. With no records the built-in random level plays.
+#define LEVEL_RECORD_SIZE 12
+
+typedef struct
+{
+    const uint8_t *records;
+    uint32_t count;
+} GameLevel;
+
+// Coarse spatial index: the world cut into GRID_CELL squares, each with
+// a bitmask of the targets and bullets whose centres are inside it. Built
+// from scratch when needed; there are few enough entities that this is
+// cheaper than keeping it up to date as they move.
+#define GRID_CELL 250
+#define GRID_COLUMNS (MAX_WORLD_SCREENS * SCREEN_WIDTH / GRID_CELL)
+#define GRID_ROWS ((SCREEN_HEIGHT + GRID_CELL - 1) / GRID_CELL)
+
+typedef struct
+{
+    uint32_t targets; // bit i: targets[i]
+    uint64_t bullets; // bit i: bullets[i]
+} GridCell;
+
+typedef struct
+{
+    GridCell cells[GRID_ROWS][GRID_COLUMNS];
+    int columns; // columns covering world_width
+} SpatialGrid;
+
+// Far targets step once every LOD_INTERVAL ticks (by that many ticks'
+// worth of speed) when far_target_lod is on. Far means more than
+// LOD_DISTANCE from every shooter and no bullet in the grid columns
+// around it.
+#define LOD_INTERVAL 4
+#define LOD_DISTANCE SCREEN_WIDTH
+
+// Global arrays. Only slots below targets_in_use can hold live targets.
+extern Target targets[MAX_TARGETS];
+extern Bullet bullets[MAX_BULLETS];
+
+// Game state
+extern int shooter_x, shooter_y;
+extern int partner_x; // second shooter in co-op, shares shooter_y
+extern int player_count;
+extern int bullets_used;
+extern int bullets_remaining;
+extern int score;
+extern int targets_killed;
+extern int targets_total;  // targets the level will spawn in all
+extern int targets_in_use; // high-water mark of the target pool
+extern bool game_running;
+extern bool game_won;
+extern bool game_lost;
+
+// Simulation clock and random state. The tick advances once per
+// update_game() call; the RNG is our own so a seed reproduces a game.
+extern uint32_t game_tick;
+extern uint32_t game_rng;
+
+// Called for every game event, NULL when nobody listens
+extern GameEventHook game_event_hook;
+
+// Level being played and the next record to spawn from it
+extern GameLevel game_level;
+extern uint32_t level_cursor;
+
+// World setup, chosen before init_game() and the same for every player
+extern int world_width;       // play field width, SCREEN_WIDTH up to MAX_WORLD_SCREENS of them
+extern bool far_target_lod;   // step far targets less often
+extern int targets_slow;      // targets on the reduced rate during the last tick
+extern uint64_t collision_pairs; // bullet/target pairs tested by the last collision pass
+
+// Function prototypes
+void game_seed(uint32_t seed);
+int game_rand();
+void init_game();
+void reset_game();
+void spawn_target(int index);
+void spawn_due_targets();
+void move_shooter(int dx);
+void shoot_bullet();
+void shoot_bullet_from(int x);
+void apply_input(int player, uint8_t input);
+void update_game();
+void step_targets_lod(); // the global targets, far ones at the reduced rate
+void check_collisions();
+GameMode game_mode();
+
+// The per-tick work over any number of entities. update_game() runs these
+// on the global arrays; simbench runs them on large ones. Targets and
+// collisions have a kernel per game mode, chosen once per tick: the _mode
+// versions take the mode, the plain ones use game_mode().
+void step_bullets(Bullet *list, int count);
+void step_targets(Target *list, int count);
+void step_targets_mode(GameMode mode, Target *list, int count);
+void collide(Bullet *bullet_list, int bullet_count, Target *target_list, int target_count);
+void collide_mode(GameMode mode, Bullet *bullet_list, int bullet_count, Target *target_list, int target_count);
+int calculate_score();
+
+// Spatial index over the global arrays. grid_query ORs together the masks
+// of every cell touching the rectangle; callers test the entities exactly.
+void grid_build(SpatialGrid *grid);
+void grid_query(const SpatialGrid *grid, int left, int top, int right, int bottom,
+                uint32_t *target_mask, uint64_t *bullet_mask);
+
+#endif
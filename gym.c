@@ -0,0 +1,372 @@
+// gym.c
+// Shared-memory vectorized environment server and client. See gym.h.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "gym.h"
+#include "snapshot.h"
+
+#define SPIN_LIMIT 2000 // polls before falling back to a futex sleep
+
+// ---- signalling ----
+
+static void futex_wait(_Atomic uint32_t *word, uint32_t expected)
+{
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(_Atomic uint32_t *word)
+{
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Wait until *word != seen. Spins briefly first since a batch is usually
+// short; sleepers announce themselves so the waker can skip the syscall.
+static uint32_t wait_for_change(_Atomic uint32_t *word, uint32_t seen, _Atomic uint32_t *sleeping)
+{
+    for (int spin = 0; spin < SPIN_LIMIT; spin++)
+    {
+        uint32_t now = atomic_load(word);
+        if (now != seen)
+            return now;
+        cpu_relax();
+    }
+
+    for (;;)
+    {
+        atomic_fetch_add(sleeping, 1);
+        uint32_t now = atomic_load(word);
+        if (now == seen)
+            futex_wait(word, seen);
+        atomic_fetch_sub(sleeping, 1);
+
+        now = atomic_load(word);
+        if (now != seen)
+            return now;
+    }
+}
+
+static void publish(_Atomic uint32_t *word, uint32_t value, _Atomic uint32_t *sleeping)
+{
+    atomic_store(word, value);
+    if (atomic_load(sleeping) > 0)
+        futex_wake(word);
+}
+
+// ---- layout ----
+
+static size_t align64(size_t n)
+{
+    return (n + 63) & ~(size_t)63;
+}
+
+static size_t layout(GymHeader *h, int env_count)
+{
+    size_t offset = align64(sizeof(GymHeader));
+    h->actions_offset = (uint32_t)offset;
+    offset = align64(offset + env_count);
+    h->observations_offset = (uint32_t)offset;
+    offset = align64(offset + env_count * sizeof(GymObservation));
+    h->rewards_offset = (uint32_t)offset;
+    offset = align64(offset + env_count * sizeof(float));
+    h->done_offset = (uint32_t)offset;
+    return align64(offset + env_count);
+}
+
+#define SEGMENT(h, offset) ((uint8_t *)(h) + (h)->offset)
+
+// ---- worker ----
+
+typedef struct
+{
+    uint8_t state[SNAPSHOT_SIZE];
+    uint32_t seed;
+    uint32_t episode;
+    bool done;
+} Env;
+
+static void write_observation(GymObservation *obs)
+{
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        obs->targets[i].x = targets[i].x;
+        obs->targets[i].y = targets[i].y;
+        obs->targets[i].dx = targets[i].dx;
+        obs->targets[i].dy = targets[i].dy;
+        obs->targets[i].active = targets[i].active;
+        obs->targets[i].hits = (uint8_t)targets[i].hits;
+        obs->targets[i].hit_points = (uint8_t)targets[i].hit_points;
+    }
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        obs->bullets[i].x = bullets[i].x;
+        obs->bullets[i].y = bullets[i].y;
+        obs->bullets[i].active = bullets[i].active;
+    }
+    obs->shooter_x = shooter_x;
+    obs->shooter_y = shooter_y;
+    obs->bullets_remaining = bullets_remaining;
+    obs->targets_killed = targets_killed;
+    obs->score = score;
+    obs->tick = game_tick;
+}
+
+static void reset_env(Env *env)
+{
+    game_seed(env->seed + env->episode * 7919u);
+    init_game();
+    env->episode++;
+    env->done = false;
+}
+
+static int total_hits()
+{
+    int hits = 0;
+    for (int i = 0; i < MAX_TARGETS; i++)
+        hits += targets[i].hits;
+    return hits;
+}
+
+static void step_env(Env *env, uint8_t action, GymObservation *obs, float *reward, uint8_t *done)
+{
+    snapshot_load(env->state, SNAPSHOT_SIZE);
+    if (env->done)
+        reset_env(env);
+
+    int hits = total_hits();
+    int killed = targets_killed;
+
+    apply_input(0, action & (INPUT_LEFT | INPUT_RIGHT | INPUT_FIRE));
+    update_game();
+
+    float r = (float)(total_hits() - hits) + 10.0f * (targets_killed - killed);
+    if (game_won)
+        r += (float)calculate_score();
+
+    env->done = game_won || game_lost || game_tick >= GYM_MAX_EPISODE_TICKS;
+    *reward = r;
+    *done = env->done;
+    write_observation(obs);
+    snapshot_save(env->state);
+}
+
+static void run_worker(GymHeader *h, int worker, uint32_t seed)
+{
+    int first = (int)((uint64_t)h->env_count * worker / h->worker_count);
+    int last = (int)((uint64_t)h->env_count * (worker + 1) / h->worker_count);
+
+    uint8_t *actions = SEGMENT(h, actions_offset);
+    GymObservation *observations = (GymObservation *)SEGMENT(h, observations_offset);
+    float *rewards = (float *)SEGMENT(h, rewards_offset);
+    uint8_t *done = SEGMENT(h, done_offset);
+
+    Env *envs = calloc(last - first > 0 ? last - first : 1, sizeof(Env));
+    if (!envs)
+        return;
+
+    // The game lives in globals, so a worker swaps each of its instances
+    // in and out as a snapshot. Only the worker's private memory is touched.
+    for (int k = first; k < last; k++)
+    {
+        Env *env = &envs[k - first];
+        env->seed = seed + (uint32_t)k * 104729u;
+        reset_env(env);
+        write_observation(&observations[k]);
+        snapshot_save(env->state);
+    }
+
+    uint32_t seen = 0;
+    for (;;)
+    {
+        seen = wait_for_change(&h->request_seq, seen, &h->workers_sleeping);
+        if (h->shutdown)
+            break;
+
+        for (int k = first; k < last; k++)
+        {
+            Env *env = &envs[k - first];
+            if (h->command == GYM_CMD_RESET)
+            {
+                reset_env(env);
+                write_observation(&observations[k]);
+                snapshot_save(env->state);
+                rewards[k] = 0;
+                done[k] = 0;
+            }
+            else
+            {
+                step_env(env, actions[k], &observations[k], &rewards[k], &done[k]);
+            }
+        }
+
+        // Last one out tells the client
+        if (atomic_fetch_add(&h->workers_done, 1) + 1 == h->worker_count)
+        {
+            atomic_store(&h->workers_done, 0);
+            publish(&h->response_seq, seen, &h->client_sleeping);
+        }
+    }
+
+    free(envs);
+}
+
+// ---- server ----
+
+bool gym_serve(GymServer *server, const char *name, int env_count, int worker_count, uint32_t seed)
+{
+    memset(server, 0, sizeof(*server));
+    if (env_count < 1)
+        return false;
+    if (worker_count < 1)
+        worker_count = 1;
+    if (worker_count > GYM_MAX_WORKERS)
+        worker_count = GYM_MAX_WORKERS;
+    if (worker_count > env_count)
+        worker_count = env_count;
+
+    GymHeader probe;
+    size_t size = layout(&probe, env_count);
+
+    snprintf(server->name, sizeof(server->name), "%s", name);
+    shm_unlink(server->name);
+    server->fd = shm_open(server->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (server->fd < 0)
+        return false;
+    if (ftruncate(server->fd, (off_t)size) != 0)
+    {
+        close(server->fd);
+        shm_unlink(server->name);
+        return false;
+    }
+
+    GymHeader *h = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, server->fd, 0);
+    if (h == MAP_FAILED)
+    {
+        close(server->fd);
+        shm_unlink(server->name);
+        return false;
+    }
+
+    memset(h, 0, size);
+    layout(h, env_count);
+    h->env_count = (uint32_t)env_count;
+    h->worker_count = (uint32_t)worker_count;
+    server->header = h;
+    server->size = size;
+
+    for (int w = 0; w < worker_count; w++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            run_worker(h, w, seed);
+            _exit(0);
+        }
+        server->workers[server->worker_count++] = pid;
+    }
+
+    // Clients look for the magic to know the workers are up
+    atomic_thread_fence(memory_order_seq_cst);
+    h->magic = GYM_MAGIC;
+    return true;
+}
+
+void gym_stop(GymServer *server)
+{
+    GymHeader *h = server->header;
+    if (!h)
+        return;
+
+    h->shutdown = 1;
+    atomic_fetch_add(&h->request_seq, 1);
+    futex_wake(&h->request_seq);
+
+    for (int w = 0; w < server->worker_count; w++)
+        waitpid(server->workers[w], NULL, 0);
+
+    munmap(h, server->size);
+    close(server->fd);
+    shm_unlink(server->name);
+    server->header = NULL;
+}
+
+// ---- client ----
+
+bool gym_connect(GymClient *client, const char *name)
+{
+    memset(client, 0, sizeof(*client));
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+        return false;
+
+    GymHeader probe;
+    if (read(fd, &probe, sizeof(probe)) != (ssize_t)sizeof(probe) || probe.magic != GYM_MAGIC)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = layout(&probe, (int)probe.env_count);
+    GymHeader *h = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (h == MAP_FAILED)
+        return false;
+
+    client->header = h;
+    client->size = size;
+    client->env_count = (int)h->env_count;
+    client->seq = atomic_load(&h->response_seq);
+    client->actions = SEGMENT(h, actions_offset);
+    client->observations = (GymObservation *)SEGMENT(h, observations_offset);
+    client->rewards = (float *)SEGMENT(h, rewards_offset);
+    client->done = SEGMENT(h, done_offset);
+    return true;
+}
+
+static void run_command(GymClient *client, uint32_t command)
+{
+    GymHeader *h = client->header;
+    uint32_t previous = client->seq;
+
+    h->command = command;
+    client->seq++;
+    publish(&h->request_seq, client->seq, &h->workers_sleeping);
+
+    // Only one batch is in flight, so the next change is our answer
+    wait_for_change(&h->response_seq, previous, &h->client_sleeping);
+}
+
+void gym_reset(GymClient *client)
+{
+    run_command(client, GYM_CMD_RESET);
+}
+
+void gym_step(GymClient *client)
+{
+    run_command(client, GYM_CMD_STEP);
+}
+
+void gym_disconnect(GymClient *client)
+{
+    if (client->header)
+        munmap(client->header, client->size);
+    client->header = NULL;
+}
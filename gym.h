@@ -0,0 +1,115 @@
+// gym.h
+// Batched step interface for training agents, over POSIX shared memory.
+// A server hosts K game instances split across worker processes. The
+// client writes K actions into the shared segment and bumps request_seq;
+// every worker steps its slice of instances and writes observations,
+// rewards and done flags straight back into the segment; the last worker
+// to finish bumps response_seq. Both sides sleep on the sequence words
+// with futexes, so no data is copied or serialized on the way.
+// The segment is a single-slot ring: one batch is in flight at a time.
+//
+// Actions are the same input byte a player produces (INPUT_* in game.h).
+// Reward per step: +1 per hit, +10 per kill, plus the final score on a win.
+// An instance that reports done is reset at the start of its next step.
+// Linux only (futex).
+
+#ifndef GYM_H
+#define GYM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "game.h"
+
+#define GYM_MAGIC 0x324d5947u // "GYM2"
+#define GYM_DEFAULT_NAME "/shooter_gym"
+#define GYM_MAX_WORKERS 64
+#define GYM_MAX_EPISODE_TICKS (60 * 60 * 5)
+
+#define GYM_CMD_STEP 1
+#define GYM_CMD_RESET 2
+
+typedef struct
+{
+    float x, y, dx, dy;
+    uint8_t active;
+    uint8_t hits;
+    uint8_t hit_points;
+    uint8_t pad;
+} GymTarget;
+
+typedef struct
+{
+    float x, y;
+    uint8_t active;
+    uint8_t pad[3];
+} GymBullet;
+
+typedef struct
+{
+    GymTarget targets[MAX_TARGETS];
+    GymBullet bullets[MAX_BULLETS];
+    int32_t shooter_x, shooter_y;
+    int32_t bullets_remaining;
+    int32_t targets_killed;
+    int32_t score;
+    uint32_t tick;
+} GymObservation;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t env_count;
+    uint32_t worker_count;
+    uint32_t command;
+    uint32_t shutdown;
+    uint32_t actions_offset;
+    uint32_t observations_offset;
+    uint32_t rewards_offset;
+    uint32_t done_offset;
+
+    // Each signalling word gets its own cache line
+    _Alignas(64) _Atomic uint32_t request_seq;
+    _Atomic uint32_t workers_sleeping;
+    _Alignas(64) _Atomic uint32_t workers_done;
+    _Alignas(64) _Atomic uint32_t response_seq;
+    _Atomic uint32_t client_sleeping;
+} GymHeader;
+
+typedef struct
+{
+    char name[64];
+    int fd;
+    GymHeader *header;
+    size_t size;
+    int worker_count;
+    pid_t workers[GYM_MAX_WORKERS];
+} GymServer;
+
+typedef struct
+{
+    GymHeader *header;
+    size_t size;
+    int env_count;
+    uint32_t seq;
+
+    // Views into the shared segment
+    uint8_t *actions;
+    GymObservation *observations;
+    float *rewards;
+    uint8_t *done;
+} GymClient;
+
+// Server side: creates the segment and forks the workers, then returns
+bool gym_serve(GymServer *server, const char *name, int env_count, int worker_count, uint32_t seed);
+void gym_stop(GymServer *server);
+
+// Client side
+bool gym_connect(GymClient *client, const char *name);
+void gym_reset(GymClient *client);
+void gym_step(GymClient *client); // steps with whatever is in client->actions
+void gym_disconnect(GymClient *client);
+
+#endif
@@ -0,0 +1,126 @@
+// gymd.c
+// Hosts the shared-memory training environments (see gym.h), or with
+// --bench measures batched steps per second for a range of batch sizes.
+//
+// usage: gymd [--envs K] [--workers W] [--name /shm_name] [--seed S]
+//        gymd --bench [--seconds S] [--workers W]
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "gym.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static double seconds_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bench(int workers, double seconds)
+{
+    static const int batch_sizes[] = {1, 4, 16, 64, 256, 1024};
+    const char *name = "/shooter_gym_bench";
+
+    printf("%6s %8s %12s %14s\n", "envs", "workers", "steps/s", "env-steps/s");
+    for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++)
+    {
+        int envs = batch_sizes[b];
+        int used_workers = workers < envs ? workers : envs;
+
+        GymServer server;
+        GymClient client;
+        if (!gym_serve(&server, name, envs, used_workers, 1) || !gym_connect(&client, name))
+        {
+            printf("could not set up %d environments\n", envs);
+            gym_stop(&server);
+            return 1;
+        }
+
+        gym_reset(&client);
+
+        uint32_t rng = 12345;
+        long steps = 0;
+        double start = seconds_now();
+        double elapsed = 0;
+        while (elapsed < seconds)
+        {
+            // Random actions, written straight into the shared segment
+            for (int k = 0; k < envs; k++)
+            {
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                client.actions[k] = (uint8_t)(rng & (INPUT_LEFT | INPUT_RIGHT | INPUT_FIRE));
+            }
+            gym_step(&client);
+            steps++;
+            if ((steps & 63) == 0)
+                elapsed = seconds_now() - start;
+        }
+        elapsed = seconds_now() - start;
+
+        printf("%6d %8d %12.0f %14.0f\n", envs, used_workers, steps / elapsed, steps * envs / elapsed);
+        fflush(stdout);
+
+        gym_disconnect(&client);
+        gym_stop(&server);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int envs = 64;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t seed = (uint32_t)time(NULL);
+    const char *name = GYM_DEFAULT_NAME;
+    bool run_bench = false;
+    double seconds = 1.0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            run_bench = true;
+        else if (i + 1 < argc && strcmp(argv[i], "--envs") == 0)
+            envs = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--workers") == 0)
+            workers = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--name") == 0)
+            name = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0)
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else if (i + 1 < argc && strcmp(argv[i], "--seconds") == 0)
+            seconds = atof(argv[++i]);
+    }
+
+    if (run_bench)
+        return bench(workers, seconds);
+
+    GymServer server;
+    if (!gym_serve(&server, name, envs, workers, seed))
+    {
+        printf("Could not create shared memory %s\n", name);
+        return 1;
+    }
+    printf("Serving %d environments on %d workers at %s (Ctrl+C to stop)\n", envs, server.worker_count, name);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    while (!stop_requested)
+        pause();
+
+    gym_stop(&server);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// level.c
+// Opening compiled level files. See level.h for the format.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "level.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool check_header(Level *level)
+{
+    const uint8_t *h = level->base;
+    if (level->size < LEVEL_HEADER_SIZE || read_u32(h) != LEVEL_MAGIC)
+        return false;
+    if ((h[4] | (h[5] << 8)) != LEVEL_VERSION || (h[6] | (h[7] << 8)) != LEVEL_RECORD_SIZE)
+        return false;
+
+    uint32_t count = read_u32(h + 8);
+    if ((level->size - LEVEL_HEADER_SIZE) / LEVEL_RECORD_SIZE < count)
+        return false;
+
+    level->level.records = h + LEVEL_HEADER_SIZE;
+    level->level.count = count;
+    level->last_tick = read_u32(h + 12);
+    return true;
+}
+
+#ifdef _WIN32
+
+// Without mmap the whole file is read in and trimming does nothing
+bool level_open(Level *level, const char *path)
+{
+    memset(level, 0, sizeof(*level));
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *data = size > 0 ? malloc((size_t)size) : NULL;
+    if (!data || fread(data, 1, (size_t)size, f) != (size_t)size)
+    {
+        free(data);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    level->base = data;
+    level->size = (size_t)size;
+    if (!check_header(level))
+    {
+        level_close(level);
+        return false;
+    }
+    return true;
+}
+
+void level_trim(Level *level, uint32_t cursor)
+{
+    (void)level;
+    (void)cursor;
+}
+
+void level_close(Level *level)
+{
+    free((void *)level->base);
+    memset(level, 0, sizeof(*level));
+}
+
+#else
+
+bool level_open(Level *level, const char *path)
+{
+    memset(level, 0, sizeof(*level));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < LEVEL_HEADER_SIZE)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (p == MAP_FAILED)
+        return false;
+
+    // Spawns are read front to back, so let the kernel read ahead
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    level->base = p;
+    level->size = (size_t)st.st_size;
+    level->mapped = true;
+    if (!check_header(level))
+    {
+        level_close(level);
+        return false;
+    }
+    return true;
+}
+
+void level_trim(Level *level, uint32_t cursor)
+{
+    if (!level->mapped)
+        return;
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t done = LEVEL_HEADER_SIZE + (size_t)cursor * LEVEL_RECORD_SIZE;
+    done -= done % page;
+    if (done < level->trimmed)
+        level->trimmed = done; // rewound, those pages are coming back in
+    if (done <= level->trimmed)
+        return;
+
+    madvise((void *)(level->base + level->trimmed), done - level->trimmed, MADV_DONTNEED);
+    level->trimmed = done;
+}
+
+void level_close(Level *level)
+{
+    if (level->mapped)
+        munmap((void *)level->base, level->size);
+    memset(level, 0, sizeof(*level));
+}
+
+#endif
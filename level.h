@@ -0,0 +1,49 @@
+// level.h
+// Scripted levels: timed waves of targets compiled by levelc from a text
+// description into a compact binary file. The game maps the file and
+// spawns from it as the tick counter reaches each record, so memory use
+// follows the live targets, not the size of the level.
+//
+// File layout, all little endian:
+//   header  magic u32 "SLVL", version u16, record size u16,
+//           record count u32, last spawn tick u32
+//   records tick u32, x i16, y i16, dx i8, dy i8, hit points u8,
+//           behaviour u8 (BEHAVIOUR_* in game.h), sorted by tick
+//
+// Only the header is checked when a level opens; the records are read as
+// they spawn. Hit points outside 1..LEVEL_MAX_HIT_POINTS are clamped then,
+// and an unknown behaviour becomes BEHAVIOUR_BOUNCE.
+
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "game.h"
+
+#define LEVEL_MAGIC 0x4c564c53u // "SLVL"
+#define LEVEL_VERSION 1
+#define LEVEL_HEADER_SIZE 16
+#define LEVEL_MAX_HIT_POINTS TARGET_MAX_HIT_POINTS
+
+typedef struct
+{
+    GameLevel level;   // what to hand to game_level
+    uint32_t last_tick;
+    const uint8_t *base;
+    size_t size;
+    bool mapped;       // false when the file was read into memory instead
+    size_t trimmed;    // bytes already handed back to the OS
+} Level;
+
+// Maps (or on Windows reads) a compiled level and checks its header
+bool level_open(Level *level, const char *path);
+
+// Lets the OS drop the pages of records before cursor. They are read back
+// from the file if a rewind or rollback needs them again.
+void level_trim(Level *level, uint32_t cursor);
+
+void level_close(Level *level);
+
+#endif
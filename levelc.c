@@ -0,0 +1,292 @@
+// levelc.c
+// Level compiler: turns a text level description into the binary format
+// in level.h. One statement per line, '#' starts a comment:
+//
+//   spawn TICK X Y DX DY [HP] [BEHAVIOUR]
+//   wave  TICK COUNT EVERY X Y DX DY STEP_X [HP] [BEHAVIOUR]
+//
+// A wave spawns COUNT targets, one every EVERY ticks from TICK, moving
+// STEP_X pixels right each time. HP defaults to 2 and BEHAVIOUR (bounce,
+// chase or dive) to bounce. Records are sorted by tick on output. X can
+// run to MAX_WORLD_SCREENS screens; a narrower world pulls such spawns in
+// to its right wall.
+//
+// usage: levelc level.txt level.lvl
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "level.h"
+
+typedef struct
+{
+    uint32_t tick;
+    int x, y, dx, dy;
+    int hit_points;
+    int behaviour;
+    uint32_t order; // line order, keeps the sort stable
+} Spawn;
+
+static Spawn *spawns = NULL;
+static size_t spawn_count = 0, spawn_capacity = 0;
+
+static bool add_spawn(const Spawn *s)
+{
+    if (spawn_count == spawn_capacity)
+    {
+        size_t capacity = spawn_capacity ? spawn_capacity * 2 : 1024;
+        Spawn *grown = realloc(spawns, capacity * sizeof(Spawn));
+        if (!grown)
+            return false;
+        spawns = grown;
+        spawn_capacity = capacity;
+    }
+    spawns[spawn_count] = *s;
+    spawns[spawn_count].order = (uint32_t)spawn_count;
+    spawn_count++;
+    return true;
+}
+
+static int parse_behaviour(const char *name)
+{
+    if (!name || strcmp(name, "bounce") == 0)
+        return BEHAVIOUR_BOUNCE;
+    if (strcmp(name, "chase") == 0)
+        return BEHAVIOUR_CHASE;
+    if (strcmp(name, "dive") == 0)
+        return BEHAVIOUR_DIVE;
+    return -1;
+}
+
+// Reads all of word as a whole number from min to max. Returns an error
+// message naming the field, or NULL. long long because long is 32 bits on
+// Windows.
+static const char *parse_number(const char *word, const char *field, long long min, long long max,
+                                long long *out)
+{
+    static char error[160];
+    char *end;
+    errno = 0;
+    long long v = strtoll(word, &end, 10);
+    if (end == word || *end != '\0' || errno == ERANGE || v < min || v > max)
+    {
+        snprintf(error, sizeof(error), "%s must be a whole number from %lld to %lld, not '%.40s'", field, min, max,
+                 word);
+        return error;
+    }
+    *out = v;
+    return NULL;
+}
+
+// The fields both statements share, from words[first] on: X Y DX DY,
+// then [HP] [BEHAVIOUR] from words[extra] if there are that many
+static const char *parse_fields(char **words, int n, int first, int extra, Spawn *s)
+{
+    static const char *names[4] = {"X", "Y", "DX", "DY"};
+    int *fields[4] = {&s->x, &s->y, &s->dx, &s->dy};
+    long long v;
+    const char *error;
+    for (int i = 0; i < 4; i++)
+    {
+        if ((error = parse_number(words[first + i], names[i], INT_MIN, INT_MAX, &v)))
+            return error;
+        *fields[i] = (int)v;
+    }
+    if (n > extra)
+    {
+        if ((error = parse_number(words[extra], "HP", 1, LEVEL_MAX_HIT_POINTS, &v)))
+            return error;
+        s->hit_points = (int)v;
+    }
+    s->behaviour = parse_behaviour(n > extra + 1 ? words[extra + 1] : NULL);
+    return NULL;
+}
+
+static const char *check_spawn(const Spawn *s)
+{
+    if (s->x < 0 || s->x > MAX_WORLD_SCREENS * SCREEN_WIDTH || s->y < 0 || s->y > SCREEN_HEIGHT)
+        return "position is outside the widest world";
+    if (s->dx < -127 || s->dx > 127 || s->dy < -127 || s->dy > 127)
+        return "speed must be between -127 and 127";
+    if (s->hit_points < 1 || s->hit_points > LEVEL_MAX_HIT_POINTS)
+        return "hit points must be between 1 and 15";
+    if (s->behaviour < 0)
+        return "behaviour must be bounce, chase or dive";
+    return NULL;
+}
+
+// Parses one line; returns an error message or NULL
+static const char *parse_line(char *line)
+{
+    char *hash = strchr(line, '#');
+    if (hash)
+        *hash = '\0';
+
+    char *words[12];
+    int n = 0;
+    for (char *w = strtok(line, " \t\r\n"); w && n < 12; w = strtok(NULL, " \t\r\n"))
+        words[n++] = w;
+    if (n == 0)
+        return NULL;
+
+    Spawn s = {0};
+    s.hit_points = 2;
+
+    if (strcmp(words[0], "spawn") == 0)
+    {
+        if (n < 6 || n > 8)
+            return "expected: spawn TICK X Y DX DY [HP] [BEHAVIOUR]";
+        long long tick;
+        const char *error = parse_number(words[1], "TICK", 0, UINT32_MAX, &tick);
+        if (!error)
+            error = parse_fields(words, n, 2, 6, &s);
+        if (!error)
+        {
+            s.tick = (uint32_t)tick;
+            error = check_spawn(&s);
+        }
+        if (error)
+            return error;
+        return add_spawn(&s) ? NULL : "out of memory";
+    }
+
+    if (strcmp(words[0], "wave") == 0)
+    {
+        if (n < 9 || n > 11)
+            return "expected: wave TICK COUNT EVERY X Y DX DY STEP_X [HP] [BEHAVIOUR]";
+        long long tick, count, every, step_x;
+        const char *error = parse_number(words[1], "TICK", 0, UINT32_MAX, &tick);
+        if (!error)
+            error = parse_number(words[2], "COUNT", 1, UINT32_MAX, &count);
+        if (!error)
+            error = parse_number(words[3], "EVERY", 0, UINT32_MAX, &every);
+        if (!error)
+            error = parse_number(words[8], "STEP_X", INT_MIN, INT_MAX, &step_x);
+        if (!error)
+            error = parse_fields(words, n, 4, 9, &s);
+        if (error)
+            return error;
+
+        // Both products fit: each factor is below 2^32, STEP_X below 2^31
+        if ((unsigned long long)tick + (unsigned long long)(count - 1) * (unsigned long long)every > UINT32_MAX)
+            return "the wave's last spawn is past tick 4294967295";
+
+        long long first_x = s.x;
+        for (long long k = 0; k < count; k++)
+        {
+            long long x = first_x + k * step_x;
+            if (x < 0 || x > MAX_WORLD_SCREENS * SCREEN_WIDTH)
+                return "position is outside the widest world";
+            s.tick = (uint32_t)(tick + k * every);
+            s.x = (int)x;
+            error = check_spawn(&s);
+            if (error)
+                return error;
+            if (!add_spawn(&s))
+                return "out of memory";
+        }
+        return NULL;
+    }
+
+    return "unknown statement (expected spawn or wave)";
+}
+
+static int compare_spawns(const void *a, const void *b)
+{
+    const Spawn *sa = a, *sb = b;
+    if (sa->tick != sb->tick)
+        return sa->tick < sb->tick ? -1 : 1;
+    return sa->order < sb->order ? -1 : 1;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        printf("usage: levelc level.txt level.lvl\n");
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "r");
+    if (!in)
+    {
+        printf("Could not read %s\n", argv[1]);
+        return 1;
+    }
+
+    char line[512];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), in))
+    {
+        line_number++;
+        const char *error = parse_line(line);
+        if (error)
+        {
+            printf("%s:%d: %s\n", argv[1], line_number, error);
+            fclose(in);
+            return 1;
+        }
+    }
+    fclose(in);
+
+    if (spawn_count == 0 || spawn_count > UINT32_MAX)
+    {
+        printf("%s: no targets\n", argv[1]);
+        return 1;
+    }
+    qsort(spawns, spawn_count, sizeof(Spawn), compare_spawns);
+
+    FILE *out = fopen(argv[2], "wb");
+    if (!out)
+    {
+        printf("Could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    uint8_t header[LEVEL_HEADER_SIZE];
+    put_u32(header, LEVEL_MAGIC);
+    put_u16(header + 4, LEVEL_VERSION);
+    put_u16(header + 6, LEVEL_RECORD_SIZE);
+    put_u32(header + 8, (uint32_t)spawn_count);
+    put_u32(header + 12, spawns[spawn_count - 1].tick);
+    fwrite(header, 1, sizeof(header), out);
+
+    for (size_t i = 0; i < spawn_count; i++)
+    {
+        const Spawn *s = &spawns[i];
+        uint8_t r[LEVEL_RECORD_SIZE];
+        put_u32(r, s->tick);
+        put_u16(r + 4, (uint16_t)(int16_t)s->x);
+        put_u16(r + 6, (uint16_t)(int16_t)s->y);
+        r[8] = (uint8_t)(int8_t)s->dx;
+        r[9] = (uint8_t)(int8_t)s->dy;
+        r[10] = (uint8_t)s->hit_points;
+        r[11] = (uint8_t)s->behaviour;
+        fwrite(r, 1, sizeof(r), out);
+    }
+
+    if (fclose(out) != 0)
+    {
+        printf("Could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%s: %zu targets, last spawn at tick %u, %zu bytes\n", argv[2], spawn_count,
+           spawns[spawn_count - 1].tick, LEVEL_HEADER_SIZE + spawn_count * LEVEL_RECORD_SIZE);
+    free(spawns);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// leveltest.c
+// Writes a level file whose records levelc would refuse: hit points of 0,
+// 16 and 255 and behaviours past BEHAVIOUR_DIVE. Spawns it and checks
+// every target came out in range with the values the header comment in
+// level.h promises. Build it with and without -DGAME_FIXED_POINT; the
+// fixed build is the one whose 4-bit fields would wrap.
+//
+// usage: leveltest [--keep FILE]  (writes FILE and leaves it behind)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "game.h"
+#include "level.h"
+
+typedef struct
+{
+    uint8_t hit_points, behaviour; // as written
+    int want_hit_points, want_behaviour;
+} Case;
+
+static const Case cases[] = {
+    {2, BEHAVIOUR_CHASE, 2, BEHAVIOUR_CHASE},
+    {0, BEHAVIOUR_DIVE, 1, BEHAVIOUR_DIVE},
+    {15, BEHAVIOUR_BOUNCE, 15, BEHAVIOUR_BOUNCE},
+    {16, BEHAVIOUR_CHASE, TARGET_MAX_HIT_POINTS, BEHAVIOUR_CHASE},
+    {255, 3, TARGET_MAX_HIT_POINTS, BEHAVIOUR_BOUNCE},
+    {1, 255, 1, BEHAVIOUR_BOUNCE},
+};
+#define CASE_COUNT (int)(sizeof(cases) / sizeof(cases[0]))
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static bool write_level(const char *path)
+{
+    uint8_t data[LEVEL_HEADER_SIZE + CASE_COUNT * LEVEL_RECORD_SIZE];
+    memset(data, 0, sizeof(data));
+    put_u32(data, LEVEL_MAGIC);
+    put_u16(data + 4, LEVEL_VERSION);
+    put_u16(data + 6, LEVEL_RECORD_SIZE);
+    put_u32(data + 8, CASE_COUNT);
+    put_u32(data + 12, 0);
+
+    // All at tick 0, spread along the top so none of them meet
+    for (int i = 0; i < CASE_COUNT; i++)
+    {
+        uint8_t *r = data + LEVEL_HEADER_SIZE + i * LEVEL_RECORD_SIZE;
+        put_u16(r + 4, (uint16_t)(100 + 100 * i));
+        put_u16(r + 6, 100);
+        r[10] = cases[i].hit_points;
+        r[11] = cases[i].behaviour;
+    }
+
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data, 1, sizeof(data), f) == sizeof(data);
+    return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = "leveltest.lvl";
+    bool keep = false;
+    if (argc == 3 && strcmp(argv[1], "--keep") == 0)
+    {
+        path = argv[2];
+        keep = true;
+    }
+
+    Level level;
+    if (!write_level(path) || !level_open(&level, path))
+    {
+        printf("Could not write and open %s\n", path);
+        return 1;
+    }
+
+    game_level = level.level;
+    game_seed(1);
+    init_game();
+    update_game();
+
+    bool ok = true;
+    for (int i = 0; i < CASE_COUNT; i++)
+    {
+        const Target *t = &targets[i];
+        bool right = t->active && t->hit_points == cases[i].want_hit_points &&
+                     t->behaviour == cases[i].want_behaviour;
+        printf("record %d: hit points %3d -> %2d, behaviour %3d -> %d: %s\n", i, cases[i].hit_points,
+               (int)t->hit_points, cases[i].behaviour, (int)t->behaviour, right ? "ok" : "WRONG");
+        ok &= right;
+    }
+
+    level_close(&level);
+    if (!keep)
+        remove(path);
+    return ok ? 0 : 1;
+}
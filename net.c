@@ -0,0 +1,701 @@
+// net.c
+// Rollback co-op over UDP. See net.h for the overview.
+
+#include <stdlib.h>
+#include <string.h>
+#include "net.h"
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#define net_close_socket closesocket
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define INVALID_SOCKET (-1)
+#define net_close_socket close
+#endif
+
+// Packet types
+#define PKT_HELLO 1
+#define PKT_WELCOME 2
+#define PKT_INPUT 3
+#define PKT_RESYNC_REQUEST 4
+#define PKT_RESYNC 5
+
+#define NO_FRAME 0xFFFFFFFFu
+#define HELLO_INTERVAL_MS 100
+#define RESYNC_RETRY_MS 250
+
+// Only movement is worth predicting, repeating a shot would be a guess too far
+#define PREDICTED_BITS (INPUT_LEFT | INPUT_RIGHT)
+
+// ---- packet helpers ----
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t shim_rand(NetShim *shim)
+{
+    uint32_t x = shim->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    shim->rng = x;
+    return x;
+}
+
+static void send_raw(NetSession *s, const uint8_t *data, int length)
+{
+    sendto(s->sock, (const char *)data, length, 0, (const struct sockaddr *)&s->peer, sizeof(s->peer));
+}
+
+// Everything goes out through here so the shim sees every packet
+static void net_send(NetSession *s, const uint8_t *data, int length, uint32_t now_ms)
+{
+    NetShim *shim = &s->shim;
+
+    if (!s->have_peer)
+        return;
+
+    s->stats.bytes_sent += length;
+    s->stats.packets_sent++;
+
+    if (shim->loss_percent > 0 && (int)(shim_rand(shim) % 100) < shim->loss_percent)
+    {
+        s->stats.packets_dropped++;
+        return;
+    }
+
+    if ((shim->latency_ms == 0 && shim->jitter_ms == 0) || shim->count == NET_SHIM_SLOTS)
+    {
+        send_raw(s, data, length);
+        return;
+    }
+
+    int delay = shim->latency_ms;
+    if (shim->jitter_ms > 0)
+        delay += (int)(shim_rand(shim) % (2 * shim->jitter_ms + 1)) - shim->jitter_ms;
+    if (delay < 0)
+        delay = 0;
+
+    shim->deliver_at[shim->count] = now_ms + (uint32_t)delay;
+    shim->length[shim->count] = (uint16_t)length;
+    memcpy(shim->data[shim->count], data, length);
+    shim->count++;
+}
+
+static void shim_flush(NetSession *s, uint32_t now_ms)
+{
+    NetShim *shim = &s->shim;
+    int kept = 0;
+
+    for (int i = 0; i < shim->count; i++)
+    {
+        if ((int32_t)(now_ms - shim->deliver_at[i]) >= 0)
+        {
+            send_raw(s, shim->data[i], shim->length[i]);
+        }
+        else
+        {
+            if (kept != i)
+            {
+                shim->deliver_at[kept] = shim->deliver_at[i];
+                shim->length[kept] = shim->length[i];
+                memcpy(shim->data[kept], shim->data[i], shim->length[i]);
+            }
+            kept++;
+        }
+    }
+    shim->count = kept;
+}
+
+// ---- setup ----
+
+static bool open_socket(NetSession *s, uint16_t port)
+{
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        return false;
+#endif
+
+    s->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s->sock == INVALID_SOCKET)
+        return false;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(s->sock, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        net_close_socket(s->sock);
+        return false;
+    }
+
+#ifdef _WIN32
+    u_long nonblocking = 1;
+    ioctlsocket(s->sock, FIONBIO, &nonblocking);
+#else
+    fcntl(s->sock, F_SETFL, fcntl(s->sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+static void session_defaults(NetSession *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->shim.rng = 0x9e3779b9u;
+    for (int i = 0; i < NET_WINDOW; i++)
+        s->remote_frame[i] = NO_FRAME;
+}
+
+bool net_host(NetSession *s, uint16_t port, uint32_t seed)
+{
+    session_defaults(s);
+    s->local_player = 0;
+    s->seed = seed;
+    return open_socket(s, port);
+}
+
+bool net_join(NetSession *s, const char *host, uint16_t port)
+{
+    session_defaults(s);
+    s->local_player = 1;
+    if (!open_socket(s, 0))
+        return false;
+
+    struct addrinfo hints, *result;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0)
+    {
+        net_close(s);
+        return false;
+    }
+    memcpy(&s->peer, result->ai_addr, sizeof(s->peer));
+    s->peer.sin_port = htons(port);
+    s->have_peer = true;
+    freeaddrinfo(result);
+    return true;
+}
+
+void net_set_shim(NetSession *s, int latency_ms, int jitter_ms, int loss_percent)
+{
+    s->shim.latency_ms = latency_ms;
+    s->shim.jitter_ms = jitter_ms;
+    s->shim.loss_percent = loss_percent;
+}
+
+void net_close(NetSession *s)
+{
+    net_close_socket(s->sock);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static uint32_t confirmed_frame(const NetSession *s)
+{
+    return s->remote_confirmed < s->frame ? s->remote_confirmed : s->frame;
+}
+
+static bool frame_in_window(const NetSession *s, uint32_t frame)
+{
+    return frame <= s->frame && s->frame - frame < NET_WINDOW;
+}
+
+// ---- events ----
+
+#define EVENT_TYPES (GAME_EVENT_LOSE + 1)
+
+// Where the tick being simulated records its events. The hook has no
+// context pointer, and only one session simulates at a time.
+static NetTickEvents *recording = NULL;
+
+static void record_event(GameEventType type, int index)
+{
+    if (recording->count < NET_MAX_TICK_EVENTS)
+    {
+        recording->type[recording->count] = (uint8_t)type;
+        recording->index[recording->count] = (int8_t)index;
+        recording->count++;
+    }
+}
+
+// Passes on what a re-simulated tick emitted beyond what it emitted last
+// time. Listeners care how many of each kind there were, so that is what
+// is compared; an event that matches an old one exactly is the old one,
+// even if the partner's late shot moved others to different slots.
+static void pass_on_new_events(NetSession *s, const NetTickEvents *before, const NetTickEvents *after,
+                               GameEventHook listener)
+{
+    int extra[EVENT_TYPES] = {0};
+    bool matched[NET_MAX_TICK_EVENTS] = {false};
+
+    for (int i = 0; i < after->count; i++)
+        extra[after->type[i]]++;
+    for (int i = 0; i < before->count; i++)
+        extra[before->type[i]]--;
+    for (int t = 0; t < EVENT_TYPES; t++)
+    {
+        if (extra[t] < 0)
+            s->stats.retracted_events += (uint64_t)-extra[t];
+    }
+
+    for (int i = 0; i < after->count; i++)
+    {
+        int type = after->type[i];
+        if (extra[type] <= 0)
+            continue;
+
+        bool heard = false;
+        for (int j = 0; j < before->count && !heard; j++)
+        {
+            if (!matched[j] && before->type[j] == type && before->index[j] == after->index[i])
+                matched[j] = heard = true;
+        }
+        if (heard)
+            continue;
+
+        extra[type]--;
+        s->stats.late_events++;
+        if (listener)
+            listener((GameEventType)type, after->index[i]);
+    }
+}
+
+// Hands every tick the partner's input is now known for to confirmed_hook
+static void pass_on_confirmed_events(NetSession *s)
+{
+    uint32_t confirmed = confirmed_frame(s);
+    for (; s->events_confirmed < confirmed; s->events_confirmed++)
+    {
+        const NetTickEvents *e = &s->events[s->events_confirmed % NET_WINDOW];
+        for (int i = 0; s->confirmed_hook && i < e->count; i++)
+            s->confirmed_hook(e->tick, (GameEventType)e->type[i], e->index[i]);
+    }
+}
+
+// ---- simulation ----
+
+static void save_state(NetSession *s, uint32_t frame)
+{
+    uint8_t *state = s->states[frame % NET_WINDOW];
+    snapshot_save(state);
+    s->checksums[frame % NET_WINDOW] = snapshot_checksum(state);
+}
+
+static void start_session(NetSession *s, uint32_t now_ms)
+{
+    s->started = true;
+    s->stats.start_ms = now_ms;
+
+    player_count = 2;
+    game_seed(s->seed);
+    init_game();
+    save_state(s, 0);
+    s->events_confirmed = 0;
+}
+
+static uint8_t remote_input_for(NetSession *s, uint32_t frame)
+{
+    if (s->remote_frame[frame % NET_WINDOW] == frame)
+        return s->remote_inputs[frame % NET_WINDOW];
+
+    // Predict: the partner keeps holding whatever they held last
+    if (s->remote_confirmed == 0)
+        return 0;
+    return s->remote_inputs[(s->remote_confirmed - 1) % NET_WINDOW] & PREDICTED_BITS;
+}
+
+static void simulate_frame(NetSession *s, uint32_t frame, bool again)
+{
+    uint8_t inputs[MAX_PLAYERS];
+    uint8_t remote = remote_input_for(s, frame);
+
+    s->used_remote[frame % NET_WINDOW] = remote;
+    inputs[s->local_player] = s->local_inputs[frame % NET_WINDOW];
+    inputs[1 - s->local_player] = remote;
+
+    // Record the tick's events, then pass them on: all of them the first
+    // time, only the new ones when re-simulating
+    NetTickEvents *events = &s->events[frame % NET_WINDOW];
+    NetTickEvents before = *events;
+    GameEventHook listener = game_event_hook;
+    events->count = 0;
+    recording = events;
+    game_event_hook = record_event;
+
+    for (int p = 0; p < MAX_PLAYERS; p++)
+        apply_input(p, inputs[p]);
+    update_game();
+    events->tick = game_tick;
+
+    game_event_hook = listener;
+    recording = NULL;
+    if (again)
+    {
+        pass_on_new_events(s, &before, events, listener);
+    }
+    else if (listener)
+    {
+        for (int i = 0; i < events->count; i++)
+            listener((GameEventType)events->type[i], events->index[i]);
+    }
+
+    save_state(s, frame + 1);
+}
+
+// Re-run every tick from frame onward with the inputs we know now
+static void resimulate_from(NetSession *s, uint32_t frame)
+{
+    uint32_t depth = s->frame - frame;
+
+    snapshot_load(s->states[frame % NET_WINDOW], SNAPSHOT_SIZE);
+    for (uint32_t f = frame; f < s->frame; f++)
+        simulate_frame(s, f, true);
+
+    s->stats.rollbacks++;
+    s->stats.rollback_depth_total += depth;
+    s->stats.resimulated_ticks += depth;
+    if (depth > s->stats.max_rollback_depth)
+        s->stats.max_rollback_depth = depth;
+}
+
+// ---- packets in ----
+// Packets are only parsed while draining the socket. Anything that reads
+// simulated states waits until the rollback they may trigger has run.
+
+typedef struct
+{
+    uint32_t rollback_from;
+    bool have_sync;
+    uint32_t sync_frame;
+    uint32_t sync_checksum;
+    bool have_resync_request;
+    uint32_t resync_agreed;
+    int resync_length;
+    uint8_t resync[NET_MAX_PACKET];
+} Pending;
+
+static void handle_input_packet(NetSession *s, const uint8_t *p, int length, Pending *pending)
+{
+    if (length < 19)
+        return;
+
+    uint32_t ack = get_u32(p + 2);
+    uint32_t sync_frame = get_u32(p + 6);
+    uint32_t sync_checksum = get_u32(p + 10);
+    uint32_t start = get_u32(p + 14);
+    int count = p[18];
+    if (length < 19 + count)
+        return;
+
+    if (ack > s->peer_ack && ack <= s->frame)
+        s->peer_ack = ack;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t f = start + i;
+        // Keep the newest confirmed input, it is what we predict from
+        if (f < s->remote_confirmed || f - s->remote_confirmed >= NET_WINDOW - 1)
+            continue;
+
+        uint8_t input = p[19 + i];
+        s->remote_inputs[f % NET_WINDOW] = input;
+        s->remote_frame[f % NET_WINDOW] = f;
+
+        // We already simulated this tick with a guess, and guessed wrong
+        if (f < s->frame && s->used_remote[f % NET_WINDOW] != input && f < pending->rollback_from)
+            pending->rollback_from = f;
+    }
+
+    while (s->remote_frame[s->remote_confirmed % NET_WINDOW] == s->remote_confirmed)
+        s->remote_confirmed++;
+
+    if (!pending->have_sync || sync_frame > pending->sync_frame)
+    {
+        pending->have_sync = true;
+        pending->sync_frame = sync_frame;
+        pending->sync_checksum = sync_checksum;
+    }
+}
+
+static void compare_sync(NetSession *s, uint32_t sync_frame, uint32_t sync_checksum)
+{
+    // Only confirmed states are final on both sides
+    if (sync_frame > confirmed_frame(s) || !frame_in_window(s, sync_frame))
+        return;
+
+    if (s->checksums[sync_frame % NET_WINDOW] == sync_checksum)
+    {
+        if (sync_frame > s->agreed_frame)
+            s->agreed_frame = sync_frame;
+        s->desynced = false;
+    }
+    else
+    {
+        s->desynced = true;
+    }
+}
+
+static void send_resync(NetSession *s, uint32_t agreed, uint32_t now_ms)
+{
+    static const uint8_t zero[SNAPSHOT_SIZE];
+    uint8_t packet[12 + SNAPSHOT_DELTA_MAX];
+    uint32_t frame = confirmed_frame(s);
+
+    // Delta against the last state we both agreed on, or a keyframe if
+    // that has already fallen out of the window
+    const uint8_t *base = zero;
+    if (agreed <= frame && frame_in_window(s, agreed))
+        base = s->states[agreed % NET_WINDOW];
+    else
+        agreed = NO_FRAME;
+
+    packet[0] = PKT_RESYNC;
+    packet[1] = (uint8_t)s->local_player;
+    put_u32(packet + 2, frame);
+    put_u32(packet + 6, agreed);
+    size_t length = snapshot_delta_encode(base, s->states[frame % NET_WINDOW], packet + 12);
+    packet[10] = (uint8_t)length;
+    packet[11] = (uint8_t)(length >> 8);
+    net_send(s, packet, 12 + (int)length, now_ms);
+}
+
+static void apply_resync(NetSession *s, const uint8_t *p, int length)
+{
+    static const uint8_t zero[SNAPSHOT_SIZE];
+    uint8_t state[SNAPSHOT_SIZE];
+
+    if (length < 12 || !s->desynced)
+        return;
+
+    uint32_t frame = get_u32(p + 2);
+    uint32_t base = get_u32(p + 6);
+    int delta_length = p[10] | (p[11] << 8);
+    if (length < 12 + delta_length || !frame_in_window(s, frame))
+        return;
+    if (base != NO_FRAME && !frame_in_window(s, base))
+        return;
+
+    memcpy(state, base == NO_FRAME ? zero : s->states[base % NET_WINDOW], SNAPSHOT_SIZE);
+    if (!snapshot_delta_apply(state, p + 12, delta_length))
+        return;
+
+    memcpy(s->states[frame % NET_WINDOW], state, SNAPSHOT_SIZE);
+    s->checksums[frame % NET_WINDOW] = snapshot_checksum(state);
+    if (frame < s->frame)
+        resimulate_from(s, frame);
+    else
+        snapshot_load(state, SNAPSHOT_SIZE);
+
+    s->agreed_frame = frame;
+    s->desynced = false;
+    s->stats.resyncs++;
+}
+
+static void receive_packets(NetSession *s, uint32_t now_ms)
+{
+    uint8_t packet[NET_MAX_PACKET];
+    Pending pending;
+    pending.rollback_from = s->frame;
+    pending.have_sync = false;
+    pending.have_resync_request = false;
+    pending.resync_length = 0;
+
+    for (;;)
+    {
+        struct sockaddr_in from;
+        socklen_t from_length = sizeof(from);
+        int length = (int)recvfrom(s->sock, (char *)packet, sizeof(packet), 0,
+                                   (struct sockaddr *)&from, &from_length);
+        if (length < 2)
+            break;
+
+        switch (packet[0])
+        {
+        case PKT_HELLO:
+            if (s->local_player == 0)
+            {
+                s->peer = from;
+                s->have_peer = true;
+                if (!s->started)
+                    start_session(s, now_ms);
+
+                uint8_t welcome[6] = {PKT_WELCOME, 0};
+                put_u32(welcome + 2, s->seed);
+                net_send(s, welcome, sizeof(welcome), now_ms);
+            }
+            break;
+        case PKT_WELCOME:
+            if (s->local_player == 1 && !s->started && length >= 6)
+            {
+                s->seed = get_u32(packet + 2);
+                start_session(s, now_ms);
+            }
+            break;
+        case PKT_INPUT:
+            if (s->started)
+                handle_input_packet(s, packet, length, &pending);
+            break;
+        case PKT_RESYNC_REQUEST:
+            if (s->local_player == 0 && s->started && length >= 6)
+            {
+                pending.have_resync_request = true;
+                pending.resync_agreed = get_u32(packet + 2);
+            }
+            break;
+        case PKT_RESYNC:
+            if (s->local_player == 1 && s->started)
+            {
+                memcpy(pending.resync, packet, length);
+                pending.resync_length = length;
+            }
+            break;
+        }
+    }
+
+    if (pending.rollback_from < s->frame)
+        resimulate_from(s, pending.rollback_from);
+    if (pending.resync_length > 0)
+        apply_resync(s, pending.resync, pending.resync_length);
+    if (pending.have_sync)
+        compare_sync(s, pending.sync_frame, pending.sync_checksum);
+    if (pending.have_resync_request)
+        send_resync(s, pending.resync_agreed, now_ms);
+}
+
+// ---- packets out ----
+
+static void send_inputs(NetSession *s, uint32_t now_ms)
+{
+    uint8_t packet[19 + NET_WINDOW];
+    uint32_t start = s->peer_ack;
+    uint32_t count = s->frame - start;
+    if (count > NET_WINDOW)
+    {
+        start = s->frame - NET_WINDOW;
+        count = NET_WINDOW;
+    }
+
+    uint32_t sync_frame = confirmed_frame(s);
+
+    packet[0] = PKT_INPUT;
+    packet[1] = (uint8_t)s->local_player;
+    put_u32(packet + 2, s->remote_confirmed);
+    put_u32(packet + 6, sync_frame);
+    put_u32(packet + 10, s->checksums[sync_frame % NET_WINDOW]);
+    put_u32(packet + 14, start);
+    packet[18] = (uint8_t)count;
+    for (uint32_t i = 0; i < count; i++)
+        packet[19 + i] = s->local_inputs[(start + i) % NET_WINDOW];
+
+    net_send(s, packet, 19 + (int)count, now_ms);
+}
+
+bool net_tick(NetSession *s, uint8_t local_input, uint32_t now_ms)
+{
+    bool advanced = false;
+
+    if (!s->started && s->local_player == 1 && now_ms - s->last_hello_ms >= HELLO_INTERVAL_MS)
+    {
+        uint8_t hello[2] = {PKT_HELLO, 1};
+        net_send(s, hello, sizeof(hello), now_ms);
+        s->last_hello_ms = now_ms;
+    }
+
+    receive_packets(s, now_ms);
+
+    if (s->started)
+    {
+        if (s->desynced && s->local_player == 1 && now_ms - s->resync_requested_at >= RESYNC_RETRY_MS)
+        {
+            uint8_t request[6] = {PKT_RESYNC_REQUEST, 1};
+            put_u32(request + 2, s->agreed_frame);
+            net_send(s, request, sizeof(request), now_ms);
+            s->resync_requested_at = now_ms;
+        }
+
+        if (s->frame_limit && s->frame >= s->frame_limit)
+        {
+            // Finished, just keep the partner fed
+        }
+        else if ((int32_t)(s->frame - s->remote_confirmed) >= NET_MAX_ROLLBACK ||
+                 s->frame - s->peer_ack >= NET_WINDOW - 1)
+        {
+            // Too far ahead of the partner to roll back safely, wait for them
+            s->stats.stalled_ticks++;
+        }
+        else
+        {
+            s->local_inputs[s->frame % NET_WINDOW] = local_input;
+            simulate_frame(s, s->frame, false);
+            s->frame++;
+            advanced = true;
+        }
+        pass_on_confirmed_events(s);
+
+        send_inputs(s, now_ms);
+    }
+
+    shim_flush(s, now_ms);
+    return advanced;
+}
+
+bool net_confirmed_checksum(const NetSession *s, uint32_t frame, uint32_t *checksum)
+{
+    if (frame > confirmed_frame(s) || !frame_in_window(s, frame))
+        return false;
+    *checksum = s->checksums[frame % NET_WINDOW];
+    return true;
+}
+
+void net_debug_corrupt(NetSession *s)
+{
+    // Bump the score in every state a rollback could restore, so the
+    // divergence sticks until a resync repairs it
+    for (uint32_t f = confirmed_frame(s); f <= s->frame; f++)
+    {
+        snapshot_load(s->states[f % NET_WINDOW], SNAPSHOT_SIZE);
+        score += 1000;
+        save_state(s, f);
+    }
+}
+
+void net_print_stats(const NetSession *s, uint32_t now_ms, FILE *out)
+{
+    const NetStats *st = &s->stats;
+    double seconds = (now_ms - st->start_ms) / 1000.0;
+    if (seconds <= 0)
+        seconds = 1;
+
+    fprintf(out, "%s: %u ticks in %.1fs, %u rollbacks (max depth %u, avg %.2f), "
+                 "%.1f resimulated ticks/s, %.1f bytes/tick, %u stalls, %u resyncs, %llu/%llu packets dropped, "
+                 "%llu late and %llu retracted events\n",
+            s->local_player == 0 ? "host" : "client",
+            s->frame, seconds, st->rollbacks, st->max_rollback_depth,
+            st->rollbacks ? (double)st->rollback_depth_total / st->rollbacks : 0.0,
+            st->resimulated_ticks / seconds,
+            s->frame ? (double)st->bytes_sent / s->frame : 0.0,
+            st->stalled_ticks, st->resyncs,
+            (unsigned long long)st->packets_dropped, (unsigned long long)st->packets_sent,
+            (unsigned long long)st->late_events, (unsigned long long)st->retracted_events);
+}
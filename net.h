@@ -0,0 +1,125 @@
+// net.h
+// Two-player co-op over UDP with rollback.
+// Both peers run the full simulation. Every tick each peer sends its
+// input for that tick (plus all inputs the other side has not acked yet)
+// and keeps going with a guess for the partner's input. When the real
+// input arrives and differs from the guess, the state is rolled back to
+// that tick from the per-tick snapshots and re-simulated.
+// Confirmed states are checksummed and compared; on a mismatch the host
+// sends the client a snapshot delta against the last state both agreed on.
+//
+// Game events reach listeners twice over. game_event_hook hears a tick as
+// soon as it is simulated, and a re-simulation only passes on the events
+// it adds (the partner's late shot, the hit that shot makes); events it
+// takes away cannot be unheard and are only counted. Good for sound.
+// confirmed_hook hears each tick once, after the partner's input for it
+// is known, so it gets exactly what happened and on which tick. Good for
+// records.
+
+#ifndef NET_H
+#define NET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "snapshot.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+typedef SOCKET net_socket;
+#else
+#include <netinet/in.h>
+typedef int net_socket;
+#endif
+
+#define NET_DEFAULT_PORT 7777
+#define NET_WINDOW 64       // ticks of inputs and states kept for rollback
+#define NET_MAX_ROLLBACK 40 // ticks we may run ahead of the partner
+#define NET_MAX_PACKET 1400
+#define NET_SHIM_SLOTS 512
+#define NET_MAX_TICK_EVENTS 128 // a shot per player, a hit and a kill per bullet, an ending
+
+// Outgoing packets parked here to fake a slow, lossy link
+typedef struct
+{
+    int latency_ms;
+    int jitter_ms;
+    int loss_percent;
+    uint32_t rng;
+
+    int count;
+    uint32_t deliver_at[NET_SHIM_SLOTS];
+    uint16_t length[NET_SHIM_SLOTS];
+    uint8_t data[NET_SHIM_SLOTS][NET_MAX_PACKET];
+} NetShim;
+
+typedef struct
+{
+    uint32_t rollbacks;
+    uint32_t max_rollback_depth;
+    uint64_t rollback_depth_total;
+    uint64_t resimulated_ticks;
+    uint32_t stalled_ticks;
+    uint32_t resyncs;
+    uint64_t bytes_sent;
+    uint64_t packets_sent;
+    uint64_t packets_dropped; // by the shim
+    uint64_t late_events;      // first heard during a re-simulation
+    uint64_t retracted_events; // heard, then undone by a re-simulation
+    uint32_t start_ms;
+} NetStats;
+
+// What one tick emitted, in order
+typedef struct
+{
+    uint32_t tick; // game_tick once the tick has run, what its events are stamped with
+    int count;
+    uint8_t type[NET_MAX_TICK_EVENTS];
+    int8_t index[NET_MAX_TICK_EVENTS];
+} NetTickEvents;
+
+// Confirmed events come late, so they carry the tick they happened on
+typedef void (*NetConfirmedHook)(uint32_t tick, GameEventType type, int index);
+
+typedef struct
+{
+    net_socket sock;
+    struct sockaddr_in peer;
+    bool have_peer;
+    bool started;
+    int local_player; // 0 = host, 1 = client
+    uint32_t seed;
+    uint32_t last_hello_ms;
+
+    uint32_t frame;      // next tick to simulate
+    uint32_t frame_limit; // stop advancing here, 0 = never
+    uint32_t remote_confirmed; // partner inputs known for every tick below this
+    uint32_t peer_ack;         // partner has our inputs for every tick below this
+    uint32_t agreed_frame;     // last tick whose checksum both sides matched
+    bool desynced;
+    uint32_t resync_requested_at;
+
+    uint8_t local_inputs[NET_WINDOW];
+    uint8_t remote_inputs[NET_WINDOW];
+    uint32_t remote_frame[NET_WINDOW]; // which tick remote_inputs[] holds
+    uint8_t used_remote[NET_WINDOW];   // what we simulated with
+    uint8_t states[NET_WINDOW][SNAPSHOT_SIZE]; // state before each tick
+    uint32_t checksums[NET_WINDOW];
+    NetTickEvents events[NET_WINDOW]; // as last simulated
+    uint32_t events_confirmed;        // ticks below this went to confirmed_hook
+    NetConfirmedHook confirmed_hook;  // NULL when nobody listens
+
+    NetShim shim;
+    NetStats stats;
+} NetSession;
+
+bool net_host(NetSession *s, uint16_t port, uint32_t seed);
+bool net_join(NetSession *s, const char *host, uint16_t port);
+void net_set_shim(NetSession *s, int latency_ms, int jitter_ms, int loss_percent);
+bool net_tick(NetSession *s, uint8_t local_input, uint32_t now_ms);
+bool net_confirmed_checksum(const NetSession *s, uint32_t frame, uint32_t *checksum);
+void net_debug_corrupt(NetSession *s);
+void net_print_stats(const NetSession *s, uint32_t now_ms, FILE *out);
+void net_close(NetSession *s);
+
+#endif
@@ -0,0 +1,338 @@
+// render_queue.c
+// Per-frame command queue in front of the SDL renderer. See render_queue.h.
+
+#include "render_queue.h"
+
+// Sort key, most significant first: layer, kind, state, submission order
+#define KEY_LAYER_SHIFT 56
+#define KEY_KIND_SHIFT 52
+#define KEY_STATE_SHIFT 20
+#define KEY_ORDER_MASK 0xFFFFFu
+
+static uint32_t pack_color(SDL_Color c)
+{
+    return ((uint32_t)c.r << 24) | ((uint32_t)c.g << 16) | ((uint32_t)c.b << 8) | c.a;
+}
+
+static uint32_t key_state(uint64_t key)
+{
+    return (uint32_t)(key >> KEY_STATE_SHIFT);
+}
+
+static RenderKind key_kind(uint64_t key)
+{
+    return (RenderKind)((key >> KEY_KIND_SHIFT) & 0xF);
+}
+
+// Everything but the submission order, i.e. what a batch must share
+static uint64_t key_batch(uint64_t key)
+{
+    return key >> KEY_STATE_SHIFT;
+}
+
+static RenderCommand *add_command(RenderQueue *q, int layer, RenderKind kind, uint32_t state)
+{
+    if (q->command_count >= RENDER_QUEUE_MAX_COMMANDS)
+    {
+        q->dropped++;
+        return NULL;
+    }
+
+    RenderCommand *cmd = &q->commands[q->command_count];
+    cmd->key = ((uint64_t)(layer & 0xFF) << KEY_LAYER_SHIFT) |
+               ((uint64_t)kind << KEY_KIND_SHIFT) |
+               ((uint64_t)state << KEY_STATE_SHIFT) |
+               ((uint32_t)q->command_count & KEY_ORDER_MASK);
+    q->command_count++;
+    return cmd;
+}
+
+void render_queue_begin(RenderQueue *q)
+{
+    q->command_count = 0;
+    q->rect_count = 0;
+    q->point_count = 0;
+    q->texture_count = 0;
+    q->dropped = 0;
+}
+
+void render_queue_fill_rect(RenderQueue *q, int layer, SDL_Color color, const SDL_Rect *rect)
+{
+    if (q->rect_count >= RENDER_QUEUE_MAX_RECTS)
+    {
+        q->dropped++;
+        return;
+    }
+
+    RenderCommand *cmd = add_command(q, layer, RENDER_FILL_RECTS, pack_color(color));
+    if (!cmd)
+        return;
+    cmd->first = (uint32_t)q->rect_count;
+    cmd->count = 1;
+    q->rects[q->rect_count++] = *rect;
+}
+
+static void add_points(RenderQueue *q, int layer, RenderKind kind, SDL_Color color,
+                       const SDL_Point *points, int count)
+{
+    if (count <= 0)
+        return;
+    if (q->point_count + count > RENDER_QUEUE_MAX_POINTS)
+    {
+        q->dropped++;
+        return;
+    }
+
+    RenderCommand *cmd = add_command(q, layer, kind, pack_color(color));
+    if (!cmd)
+        return;
+    cmd->first = (uint32_t)q->point_count;
+    cmd->count = (uint32_t)count;
+    for (int i = 0; i < count; i++)
+        q->points[q->point_count++] = points[i];
+}
+
+void render_queue_points(RenderQueue *q, int layer, SDL_Color color, const SDL_Point *points, int count)
+{
+    add_points(q, layer, RENDER_POINTS, color, points, count);
+}
+
+void render_queue_line_strip(RenderQueue *q, int layer, SDL_Color color, const SDL_Point *points, int count)
+{
+    add_points(q, layer, RENDER_LINE_STRIP, color, points, count);
+}
+
+void render_queue_outline_rect(RenderQueue *q, int layer, SDL_Color color, const SDL_Rect *rect)
+{
+    // Same pixels as SDL_RenderDrawRect
+    int right = rect->x + rect->w - 1;
+    int bottom = rect->y + rect->h - 1;
+    SDL_Point corners[5] = {
+        {rect->x, rect->y},
+        {right, rect->y},
+        {right, bottom},
+        {rect->x, bottom},
+        {rect->x, rect->y}};
+    add_points(q, layer, RENDER_LINE_STRIP, color, corners, 5);
+}
+
+void render_queue_texture(RenderQueue *q, int layer, SDL_Texture *texture, bool owned,
+                          const SDL_Rect *src, const SDL_Rect *dst)
+{
+    // Textures sort by the slot they were first seen in
+    int slot = 0;
+    while (slot < q->texture_count && q->textures[slot] != texture)
+        slot++;
+
+    if (slot == RENDER_QUEUE_MAX_TEXTURES || q->rect_count + 2 > RENDER_QUEUE_MAX_RECTS ||
+        q->command_count >= RENDER_QUEUE_MAX_COMMANDS)
+    {
+        q->dropped++;
+        if (owned)
+            SDL_DestroyTexture(texture);
+        return;
+    }
+    if (slot == q->texture_count)
+    {
+        q->textures[slot] = texture;
+        q->owned[slot] = owned;
+        q->texture_count++;
+    }
+
+    RenderCommand *cmd = add_command(q, layer, RENDER_TEXTURE, (uint32_t)slot);
+    cmd->first = (uint32_t)q->rect_count;
+    cmd->count = 2;
+
+    // A zero-sized source means the whole texture
+    SDL_Rect whole = {0, 0, 0, 0};
+    q->rects[q->rect_count++] = src ? *src : whole;
+    q->rects[q->rect_count++] = *dst;
+}
+
+// Bottom-up merge sort by key. qsort would do, but glibc's allocates a
+// temporary copy for arrays this size on every call.
+static void sort_commands(RenderCommand *commands, int count)
+{
+    static RenderCommand scratch[RENDER_QUEUE_MAX_COMMANDS];
+    RenderCommand *from = commands, *to = scratch;
+
+    for (int width = 1; width < count; width *= 2)
+    {
+        for (int lo = 0; lo < count; lo += 2 * width)
+        {
+            int mid = lo + width < count ? lo + width : count;
+            int hi = lo + 2 * width < count ? lo + 2 * width : count;
+            int a = lo, b = mid, out = lo;
+            while (a < mid && b < hi)
+                to[out++] = from[b].key < from[a].key ? from[b++] : from[a++];
+            while (a < mid)
+                to[out++] = from[a++];
+            while (b < hi)
+                to[out++] = from[b++];
+        }
+        RenderCommand *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != commands)
+    {
+        for (int i = 0; i < count; i++)
+            commands[i] = from[i];
+    }
+}
+
+static SDL_FRect to_frect(const SDL_Rect *r)
+{
+    SDL_FRect f = {(float)r->x, (float)r->y, (float)r->w, (float)r->h};
+    return f;
+}
+
+// Appends the four corners of a quad: src in texels (zero-sized for the
+// whole texture) mapped onto dst
+static SDL_Vertex *add_quad(SDL_Vertex *v, const SDL_Rect *src, const SDL_Rect *dst, int texture_w, int texture_h)
+{
+    static const SDL_Color white = {255, 255, 255, 255};
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+    if (src->w && texture_w > 0 && texture_h > 0)
+    {
+        u0 = (float)src->x / texture_w;
+        v0 = (float)src->y / texture_h;
+        u1 = (float)(src->x + src->w) / texture_w;
+        v1 = (float)(src->y + src->h) / texture_h;
+    }
+    float x0 = (float)dst->x, y0 = (float)dst->y;
+    float x1 = (float)(dst->x + dst->w), y1 = (float)(dst->y + dst->h);
+
+    v[0] = (SDL_Vertex){{x0, y0}, white, {u0, v0}};
+    v[1] = (SDL_Vertex){{x1, y0}, white, {u1, v0}};
+    v[2] = (SDL_Vertex){{x1, y1}, white, {u1, v1}};
+    v[3] = (SDL_Vertex){{x0, y1}, white, {u0, v1}};
+    return v + 4;
+}
+
+void render_queue_flush(RenderQueue *q, SDL_Renderer *renderer)
+{
+    // Batches are gathered here so each becomes one call
+    static SDL_FRect batch_rects[RENDER_QUEUE_MAX_RECTS];
+    static SDL_FPoint batch_points[RENDER_QUEUE_MAX_POINTS];
+    static SDL_Vertex batch_vertices[RENDER_QUEUE_MAX_COMMANDS * 4];
+    static int quad_indices[RENDER_QUEUE_MAX_COMMANDS * 6];
+    static bool have_indices = false;
+
+    // Every mesh is quads, so one index list serves them all
+    if (!have_indices)
+    {
+        for (int k = 0; k < RENDER_QUEUE_MAX_COMMANDS; k++)
+        {
+            int *index = &quad_indices[k * 6];
+            index[0] = k * 4;
+            index[1] = k * 4 + 1;
+            index[2] = k * 4 + 2;
+            index[3] = k * 4;
+            index[4] = k * 4 + 2;
+            index[5] = k * 4 + 3;
+        }
+        have_indices = true;
+    }
+
+    sort_commands(q->commands, q->command_count);
+
+    RenderStats stats = {q->command_count, 0, 0, q->dropped};
+    bool have_color = false;
+    uint32_t color = 0;
+
+    int i = 0;
+    while (i < q->command_count)
+    {
+        uint64_t batch = key_batch(q->commands[i].key);
+        RenderKind kind = key_kind(q->commands[i].key);
+        uint32_t state = key_state(q->commands[i].key);
+
+        int end = i + 1;
+        while (end < q->command_count && key_batch(q->commands[end].key) == batch)
+            end++;
+
+        if (kind != RENDER_TEXTURE && (!have_color || color != state))
+        {
+            SDL_SetRenderDrawColor(renderer, state >> 24, (state >> 16) & 0xFF, (state >> 8) & 0xFF, state & 0xFF);
+            color = state;
+            have_color = true;
+            stats.state_changes++;
+        }
+
+        switch (kind)
+        {
+        case RENDER_FILL_RECTS:
+        {
+            int n = 0;
+            for (int c = i; c < end; c++)
+                batch_rects[n++] = to_frect(&q->rects[q->commands[c].first]);
+            SDL_RenderFillRectsF(renderer, batch_rects, n);
+            stats.draw_calls++;
+            break;
+        }
+        case RENDER_POINTS:
+        {
+            int n = 0;
+            for (int c = i; c < end; c++)
+            {
+                for (uint32_t p = 0; p < q->commands[c].count; p++)
+                {
+                    const SDL_Point *point = &q->points[q->commands[c].first + p];
+                    batch_points[n++] = (SDL_FPoint){(float)point->x, (float)point->y};
+                }
+            }
+            SDL_RenderDrawPointsF(renderer, batch_points, n);
+            stats.draw_calls++;
+            break;
+        }
+        case RENDER_LINE_STRIP:
+            // Strips cannot be joined without drawing the gap between them
+            for (int c = i; c < end; c++)
+            {
+                int n = (int)q->commands[c].count;
+                for (int p = 0; p < n; p++)
+                {
+                    const SDL_Point *point = &q->points[q->commands[c].first + p];
+                    batch_points[p] = (SDL_FPoint){(float)point->x, (float)point->y};
+                }
+                SDL_RenderDrawLinesF(renderer, batch_points, n);
+                stats.draw_calls++;
+            }
+            break;
+        case RENDER_TEXTURE:
+        {
+            SDL_Texture *texture = q->textures[state];
+            int texture_w = 0, texture_h = 0;
+            SDL_QueryTexture(texture, NULL, NULL, &texture_w, &texture_h);
+
+            SDL_Vertex *v = batch_vertices;
+            for (int c = i; c < end; c++)
+            {
+                const SDL_Rect *src = &q->rects[q->commands[c].first];
+                v = add_quad(v, src, src + 1, texture_w, texture_h);
+            }
+            int quads = end - i;
+            SDL_RenderGeometry(renderer, texture, batch_vertices, quads * 4, quad_indices, quads * 6);
+            stats.state_changes++;
+            stats.draw_calls++;
+            break;
+        }
+        }
+
+        i = end;
+    }
+
+    for (int t = 0; t < q->texture_count; t++)
+    {
+        if (q->owned[t])
+            SDL_DestroyTexture(q->textures[t]);
+    }
+
+    q->stats = stats;
+    q->frames++;
+    q->total_draw_calls += stats.draw_calls;
+    q->total_state_changes += stats.state_changes;
+    render_queue_begin(q);
+}
@@ -0,0 +1,95 @@
+// render_queue.h
+// Deferred drawing for one frame. render_game() queues filled rects, points,
+// line strips and textured quads, each with a layer, instead of talking to
+// SDL directly. The flush sorts by layer, then primitive, then colour (or
+// texture), so every run of same-coloured rects or points becomes a single
+// SDL_RenderFillRects / SDL_RenderDrawPoints call and the draw colour only
+// changes between runs. Textured quads from one texture (a colour's glyph
+// atlas) become a single SDL_RenderGeometry mesh, two triangles a quad.
+//
+// Order is only kept between layers. Within a layer, commands of different
+// colours may be drawn in any order, so anything that must overlap
+// something else needs its own layer.
+//
+// Queueing and flushing never touch the heap: the queue's arrays are fixed,
+// the sort uses a static scratch buffer, and the flush calls SDL's float
+// entry points, which draw from the caller's arrays where the int ones
+// convert through a temporary SDL_malloc'd copy (SDL 2.0.10 or later;
+// SDL_RenderGeometry needs 2.0.18).
+
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#define RENDER_QUEUE_MAX_COMMANDS 4096 // glyphs are a command each
+#define RENDER_QUEUE_MAX_RECTS 4096
+#define RENDER_QUEUE_MAX_POINTS 4096
+#define RENDER_QUEUE_MAX_TEXTURES 64
+
+typedef enum
+{
+    RENDER_FILL_RECTS,
+    RENDER_POINTS,
+    RENDER_LINE_STRIP,
+    RENDER_TEXTURE
+} RenderKind;
+
+typedef struct
+{
+    uint64_t key;   // layer, kind, colour or texture slot, submission order
+    uint32_t first; // into rects or points
+    uint32_t count;
+} RenderCommand;
+
+// What the last flush cost
+typedef struct
+{
+    int commands;      // queued
+    int draw_calls;    // SDL draw calls issued
+    int state_changes; // draw colour or texture switches
+    int dropped;       // commands that did not fit
+} RenderStats;
+
+typedef struct
+{
+    RenderCommand commands[RENDER_QUEUE_MAX_COMMANDS];
+    int command_count;
+
+    SDL_Rect rects[RENDER_QUEUE_MAX_RECTS];
+    int rect_count;
+    SDL_Point points[RENDER_QUEUE_MAX_POINTS];
+    int point_count;
+
+    // Textures seen this frame; owned ones are destroyed after the flush
+    SDL_Texture *textures[RENDER_QUEUE_MAX_TEXTURES];
+    bool owned[RENDER_QUEUE_MAX_TEXTURES];
+    int texture_count;
+
+    int dropped;
+    RenderStats stats;
+
+    // Running totals for the exit report
+    uint64_t frames;
+    uint64_t total_draw_calls;
+    uint64_t total_state_changes;
+} RenderQueue;
+
+void render_queue_begin(RenderQueue *q);
+
+void render_queue_fill_rect(RenderQueue *q, int layer, SDL_Color color, const SDL_Rect *rect);
+void render_queue_points(RenderQueue *q, int layer, SDL_Color color, const SDL_Point *points, int count);
+void render_queue_line_strip(RenderQueue *q, int layer, SDL_Color color, const SDL_Point *points, int count);
+void render_queue_outline_rect(RenderQueue *q, int layer, SDL_Color color, const SDL_Rect *rect);
+
+// src may be NULL for the whole texture. With owned set the queue destroys
+// the texture once it has been drawn.
+void render_queue_texture(RenderQueue *q, int layer, SDL_Texture *texture, bool owned,
+                          const SDL_Rect *src, const SDL_Rect *dst);
+
+// Sorts, draws everything and fills q->stats. Leaves the queue empty.
+void render_queue_flush(RenderQueue *q, SDL_Renderer *renderer);
+
+#endif
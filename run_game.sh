@@ -20,19 +20,8 @@ else
 fi
 
 echo ""
-echo "2. Copying required files..."
-
-# Copy font if it exists in Windows
-if [ -f "/c/Windows/Fonts/arial.ttf" ]; then
-    cp /c/Windows/Fonts/arial.ttf . 2>/dev/null && echo "✓ Copied arial.ttf"
-else
-    echo "⚠ Warning: Could not find arial.ttf"
-    echo "   Creating placeholder font file..."
-    touch arial.ttf
-fi
-
 # Copy DLLs
-echo "3. Copying DLL files..."
+echo "2. Copying DLL files..."
 for dll in SDL2.dll SDL2_ttf.dll libfreetype-6.dll libpng16-16.dll zlib1.dll; do
     if [ -f "/mingw64/bin/$dll" ]; then
         cp "/mingw64/bin/$dll" . 2>/dev/null && echo "✓ Copied $dll"
@@ -40,7 +29,7 @@ for dll in SDL2.dll SDL2_ttf.dll libfreetype-6.dll libpng16-16.dll zlib1.dll; do
 done
 
 echo ""
-echo "4. Starting game..."
+echo "3. Starting game..."
 echo "================================="
 echo ""
 ./shooter.exe
\ No newline at end of file
@@ -0,0 +1,267 @@
+// selfplay.c
+// Headless batch runner: plays many games with bots on every core and
+// writes win rate, bullets-used and score distributions to a CSV.
+// Each game gets its own seed (base seed + game number), so any single
+// game can be replayed exactly.
+//
+// usage: selfplay [--games N] [--policy random|greedy|lead|all]
+//                 [--workers N] [--seed S] [--out results.csv]
+//                 [--level file.lvl]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "game.h"
+#include "bot.h"
+#include "level.h"
+
+#define MAX_TICKS (60 * 60 * 5) // five minutes of play counts as a loss
+#define MAX_WORKERS 256
+
+typedef struct
+{
+    uint32_t games;
+    uint32_t wins;
+    uint32_t timeouts;
+    uint64_t ticks;
+    double seconds; // CPU time the worker spent playing these games
+    uint32_t bullets_used[MAX_BULLETS + 1];
+    uint32_t win_bullets_used[MAX_BULLETS + 1];
+    uint32_t scores[101];
+} Tally;
+
+static double seconds_on(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void play_one(BotPolicy policy, uint32_t seed, Tally *tally)
+{
+    Bot bot;
+    game_seed(seed);
+    init_game();
+    bot_init(&bot, policy, seed ^ 0xa5a5a5a5u);
+
+    uint32_t ticks = 0;
+    while (!game_won && !game_lost && ticks < MAX_TICKS)
+    {
+        apply_input(0, bot_input(&bot, 0));
+        update_game();
+        ticks++;
+    }
+
+    tally->games++;
+    tally->ticks += ticks;
+    tally->bullets_used[bullets_used]++;
+    if (game_won)
+    {
+        tally->wins++;
+        tally->win_bullets_used[bullets_used]++;
+    }
+    else if (!game_lost)
+    {
+        tally->timeouts++;
+    }
+    tally->scores[score < 0 ? 0 : score > 100 ? 100 : score]++;
+}
+
+static void run_worker(int worker, int workers, int games, const bool *enabled, uint32_t seed, Tally *tallies)
+{
+    for (int p = 0; p < BOT_POLICY_COUNT; p++)
+    {
+        if (!enabled[p])
+            continue;
+
+        // CPU time rather than wall time, so per-core throughput still
+        // means something when there are more workers than cores
+        double start = seconds_on(CLOCK_PROCESS_CPUTIME_ID);
+        for (int g = worker; g < games; g += workers)
+            play_one((BotPolicy)p, seed + (uint32_t)g, &tallies[p]);
+        tallies[p].seconds = seconds_on(CLOCK_PROCESS_CPUTIME_ID) - start;
+    }
+}
+
+static void merge(Tally *into, const Tally *from)
+{
+    into->games += from->games;
+    into->wins += from->wins;
+    into->timeouts += from->timeouts;
+    into->ticks += from->ticks;
+    into->seconds += from->seconds;
+    for (int i = 0; i <= MAX_BULLETS; i++)
+    {
+        into->bullets_used[i] += from->bullets_used[i];
+        into->win_bullets_used[i] += from->win_bullets_used[i];
+    }
+    for (int i = 0; i <= 100; i++)
+        into->scores[i] += from->scores[i];
+}
+
+static void write_csv(FILE *out, const bool *enabled, const Tally *totals)
+{
+    fprintf(out, "section,policy,key,value\n");
+    for (int p = 0; p < BOT_POLICY_COUNT; p++)
+    {
+        if (!enabled[p])
+            continue;
+
+        const Tally *t = &totals[p];
+        const char *name = bot_policy_name((BotPolicy)p);
+        fprintf(out, "summary,%s,games,%u\n", name, t->games);
+        fprintf(out, "summary,%s,wins,%u\n", name, t->wins);
+        fprintf(out, "summary,%s,win_rate,%.4f\n", name, t->games ? (double)t->wins / t->games : 0.0);
+        fprintf(out, "summary,%s,timeouts,%u\n", name, t->timeouts);
+        fprintf(out, "summary,%s,mean_ticks,%.1f\n", name, t->games ? (double)t->ticks / t->games : 0.0);
+        fprintf(out, "summary,%s,games_per_sec_per_core,%.1f\n", name, t->seconds > 0 ? t->games / t->seconds : 0.0);
+
+        for (int i = 0; i <= MAX_BULLETS; i++)
+            if (t->bullets_used[i])
+                fprintf(out, "bullets_used,%s,%d,%u\n", name, i, t->bullets_used[i]);
+        for (int i = 0; i <= MAX_BULLETS; i++)
+            if (t->win_bullets_used[i])
+                fprintf(out, "win_bullets_used,%s,%d,%u\n", name, i, t->win_bullets_used[i]);
+        for (int i = 0; i <= 100; i++)
+            if (t->scores[i])
+                fprintf(out, "score,%s,%d,%u\n", name, i, t->scores[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int games = 10000;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t seed = 1;
+    const char *policy_name = "all";
+    const char *out_path = "selfplay.csv";
+    const char *level_path = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--games") == 0)
+            games = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--policy") == 0)
+            policy_name = argv[i + 1];
+        else if (strcmp(argv[i], "--workers") == 0)
+            workers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            seed = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--out") == 0)
+            out_path = argv[i + 1];
+        else if (strcmp(argv[i], "--level") == 0)
+            level_path = argv[i + 1];
+    }
+
+    // Workers inherit the mapping when they fork
+    Level level;
+    if (level_path)
+    {
+        if (!level_open(&level, level_path))
+        {
+            printf("Could not open level %s\n", level_path);
+            return 1;
+        }
+        game_level = level.level;
+    }
+
+    bool enabled[BOT_POLICY_COUNT] = {false};
+    if (strcmp(policy_name, "all") == 0)
+    {
+        for (int p = 0; p < BOT_POLICY_COUNT; p++)
+            enabled[p] = true;
+    }
+    else
+    {
+        BotPolicy policy;
+        if (!bot_policy_from_name(policy_name, &policy))
+        {
+            printf("Unknown policy '%s'\n", policy_name);
+            return 1;
+        }
+        enabled[policy] = true;
+    }
+
+    if (workers < 1)
+        workers = 1;
+    if (workers > MAX_WORKERS)
+        workers = MAX_WORKERS;
+    if (workers > games)
+        workers = games > 0 ? games : 1;
+
+    // One process per worker: the simulation lives in globals, so each
+    // worker gets its own copy for free. Results come back once, at the end.
+    int fds[MAX_WORKERS];
+    double start = seconds_on(CLOCK_MONOTONIC);
+    for (int w = 0; w < workers; w++)
+    {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0)
+            return 1;
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            static Tally tallies[BOT_POLICY_COUNT];
+            close(pipe_fds[0]);
+            run_worker(w, workers, games, enabled, seed, tallies);
+            ssize_t written = write(pipe_fds[1], tallies, sizeof(tallies));
+            _exit(written == (ssize_t)sizeof(tallies) ? 0 : 1);
+        }
+        close(pipe_fds[1]);
+        fds[w] = pipe_fds[0];
+    }
+
+    static Tally totals[BOT_POLICY_COUNT];
+    for (int w = 0; w < workers; w++)
+    {
+        static Tally tallies[BOT_POLICY_COUNT];
+        size_t got = 0;
+        while (got < sizeof(tallies))
+        {
+            ssize_t n = read(fds[w], (char *)tallies + got, sizeof(tallies) - got);
+            if (n <= 0)
+                break;
+            got += (size_t)n;
+        }
+        close(fds[w]);
+        if (got != sizeof(tallies))
+        {
+            printf("Worker %d failed\n", w);
+            continue;
+        }
+        for (int p = 0; p < BOT_POLICY_COUNT; p++)
+            merge(&totals[p], &tallies[p]);
+    }
+    while (wait(NULL) > 0)
+        ;
+    double elapsed = seconds_on(CLOCK_MONOTONIC) - start;
+
+    FILE *out = fopen(out_path, "w");
+    if (!out)
+    {
+        printf("Could not write %s\n", out_path);
+        return 1;
+    }
+    write_csv(out, enabled, totals);
+    fclose(out);
+
+    uint32_t total_games = 0;
+    for (int p = 0; p < BOT_POLICY_COUNT; p++)
+    {
+        if (!enabled[p])
+            continue;
+        const Tally *t = &totals[p];
+        total_games += t->games;
+        printf("%-7s %6u games  win rate %5.1f%%  %8.1f games/s/core\n",
+               bot_policy_name((BotPolicy)p), t->games,
+               t->games ? 100.0 * t->wins / t->games : 0.0,
+               t->seconds > 0 ? t->games / t->seconds : 0.0);
+    }
+    printf("%u games on %d workers in %.2fs (%.1f games/s), results in %s\n",
+           total_games, workers, elapsed, total_games / elapsed, out_path);
+    return 0;
+}
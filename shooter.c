@@ -11,73 +11,215 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
-
-// Game Constants
-#define SCREEN_WIDTH 1500
-#define SCREEN_HEIGHT 750
-#define TARGET_COUNT 10
-#define MAX_BULLETS 50
-#define SHOOTER_SPEED 5
-#define BULLET_SPEED 10
-#define TARGET_SPEED 2
-
-// Game Structures
-typedef struct
-{
-    float x, y;
-    float dx, dy;
-    bool active;
-    int hits;
-} Target;
-
-typedef struct
-{
-    float x, y;
-    bool active;
-} Bullet;
-
-// Global arrays
-Target targets[TARGET_COUNT];
-Bullet bullets[MAX_BULLETS];
-
-// Game state
-int shooter_x, shooter_y;
-int bullets_used = 0;
-int bullets_remaining = MAX_BULLETS;
-int score = 0;
-int targets_killed = 0;
-bool game_running = true;
-bool game_won = false;
-bool game_lost = false;
+#include "game.h"
+#include "snapshot.h"
+#include "net.h"
+#include "telemetry.h"
+#include "assets.h"
+#include "render_queue.h"
+#include "level.h"
+#include "alloctrack.h"
+#include "audio.h"
 
 // SDL variables
 SDL_Window *window = NULL;
 SDL_Renderer *renderer = NULL;
 TTF_Font *font = NULL;
 
+// Text is drawn from glyph atlases: the printable ASCII glyphs rendered
+// once per colour into one texture, so a frame's text costs no surfaces,
+// textures or allocations. Every colour shares the same layout.
+#define GLYPH_FIRST 32
+#define GLYPH_LAST 126
+#define GLYPH_COUNT (GLYPH_LAST - GLYPH_FIRST + 1)
+#define MAX_TEXT_COLORS 8
+
+typedef struct
+{
+    SDL_Color color;
+    SDL_Texture *texture;
+} GlyphAtlas;
+
+GlyphAtlas glyph_atlases[MAX_TEXT_COLORS];
+int glyph_atlas_count = 0;
+SDL_Rect glyph_rects[GLYPH_COUNT]; // where each glyph sits in an atlas
+int glyph_advance[GLYPH_COUNT];
+
+// Everything drawn in a frame goes through this queue, back to front
+RenderQueue frame_queue;
+enum
+{
+    LAYER_STARS,
+    LAYER_SHIPS,
+    LAYER_SHIP_OUTLINES,
+    LAYER_TARGETS,
+    LAYER_TARGET_OUTLINES,
+    LAYER_HIT_MARKS,
+    LAYER_HIT_OUTLINES,
+    LAYER_BULLETS,
+    LAYER_PANELS,
+    LAYER_PANEL_FG, // fills drawn on top of a panel; a layer keeps no order
+    LAYER_PANEL_BORDERS,
+    LAYER_TEXT
+};
+
+// Rewind history, about 30 seconds at 60 ticks per second
+SnapshotRing history;
+
+// Co-op session, only used with --host or --join
+bool net_mode = false;
+NetSession *session = NULL;
+uint8_t net_presses = 0; // FIRE/RESET pressed since the last net tick
+
+// Spectator feed, only used with --telemetry
+Telemetry telemetry;
+
+// Scripted level, only used with --level
+Level level;
+
+// View into the world, which can be wider than the window (--world).
+// Only entities the spatial grid puts near the view get drawn.
+int camera_x = 0;
+SpatialGrid view_grid;
+int view_drawn = 0, view_culled = 0; // targets and bullets, last frame
+uint64_t total_drawn = 0, total_culled = 0, total_slow = 0, total_pairs = 0, culled_frames = 0;
+
+// Input-to-present latency: each key press's SDL timestamp waits here
+// until the first SDL_RenderPresent after it has been acted on
+#define LATENCY_MAX_PENDING 32
+#define LATENCY_MAX_SAMPLES 8192 // the most recent presses are kept
+Uint32 pending_presses[LATENCY_MAX_PENDING];
+int pending_count = 0;
+Uint16 latency_ms[LATENCY_MAX_SAMPLES];
+uint64_t latency_count = 0;
+
+// --low-latency: no vsync, a spin/sleep wait to the next frame, and
+// input read just before the frame is simulated and drawn
+bool low_latency = false;
+bool muted = false;
+Uint64 frame_deadline = 0;
+
+// --inject-presses S: a timer presses a key that does nothing every
+// 20-59 ms for S seconds and then quits, so the latency report needs no
+// player. With SDL_VIDEODRIVER=dummy it needs no display either.
+#define INJECT_KEY SDLK_F12
+int inject_seconds = 0;
+
+// Left/right presses since the last frame, so a tap shorter than a frame
+// still moves the shooter once
+uint8_t local_taps = 0;
+
+// Startup timing, reported once the first frame is on screen
+Uint64 startup_begin = 0;
+double startup_sdl_ms = 0, startup_window_ms = 0, startup_font_ms = 0;
+
 // Function prototypes
-void init_game();
 void cleanup_game();
-void reset_game();
 void handle_input();
-void update_game();
+uint8_t sample_net_input();
+bool start_net(int argc, char *argv[]);
+void on_game_event(GameEventType type, int index);
+void on_confirmed_event(uint32_t tick, GameEventType type, int index);
+void rewind_game(int ticks);
+double startup_elapsed_ms();
+void note_press(Uint32 timestamp);
+void note_present();
+void print_latency();
+Uint32 SDLCALL inject_press(Uint32 interval, void *param);
+void wait_until(Uint64 deadline);
 void render_game();
-void spawn_target(int index);
-void shoot_bullet();
-void check_collisions();
-int calculate_score();
 void render_text(const char *text, int x, int y, SDL_Color color);
+SDL_Texture *glyph_atlas(SDL_Color color);
+void free_glyph_atlases();
+void fill_rect(SDL_Color color, const SDL_Rect *rect);
+void outline_rect(SDL_Color color, const SDL_Rect *rect);
 void draw_triangle(int x, int y, int size, SDL_Color color);
-void draw_oval(int center_x, int center_y, int width, int height, SDL_Color color);
+void draw_oval(int center_x, int center_y, int width, int height, SDL_Color color, int layer);
+void draw_world();
 
 int main(int argc, char *argv[])
 {
     // Tell SDL we're handling main ourselves
     SDL_SetMainReady();
+    alloc_track_init();
+    startup_begin = SDL_GetPerformanceCounter();
+
+    // --level file.lvl plays a compiled level instead of random targets.
+    // Both co-op players need the same one.
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--level") == 0)
+        {
+            if (!level_open(&level, argv[i + 1]))
+            {
+                printf("Could not open level %s\n", argv[i + 1]);
+                return 1;
+            }
+            game_level = level.level;
+            printf("Level %s: %u targets over %u ticks\n", argv[i + 1], level.level.count, level.last_tick);
+        }
+    }
+
+    // --world N makes the play field N screens wide, --far-lod steps
+    // targets far from the action less often. Co-op players need the same.
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--world") == 0 && i + 1 < argc)
+        {
+            int screens = atoi(argv[++i]);
+            if (screens < 1 || screens > MAX_WORLD_SCREENS)
+            {
+                printf("--world takes 1 to %d screens\n", MAX_WORLD_SCREENS);
+                return 1;
+            }
+            world_width = screens * SCREEN_WIDTH;
+        }
+        else if (strcmp(argv[i], "--far-lod") == 0)
+        {
+            far_target_lod = true;
+        }
+        else if (strcmp(argv[i], "--low-latency") == 0)
+        {
+            low_latency = true;
+        }
+        else if (strcmp(argv[i], "--inject-presses") == 0 && i + 1 < argc)
+        {
+            inject_seconds = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--mute") == 0)
+        {
+            muted = true;
+        }
+        else if (strcmp(argv[i], "--alloc-assert") == 0)
+        {
+            // Only does anything in an ALLOC_TRACKING build
+            alloc_track_set_strict(true);
+        }
+    }
+
+    // --host [port] or --join host[:port] start a co-op session
+    if (!start_net(argc, argv))
+    {
+        return 1;
+    }
+
+    // --telemetry publishes every tick for spectate and other readers
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--telemetry") == 0)
+        {
+            if (telemetry_open_writer(&telemetry, TELEMETRY_DEFAULT_NAME))
+                printf("Publishing telemetry at %s\n", TELEMETRY_DEFAULT_NAME);
+            else
+                printf("Could not open telemetry feed. Continuing without it.\n");
+        }
+    }
+    game_event_hook = on_game_event;
 
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -85,6 +227,13 @@ int main(int argc, char *argv[])
         printf("SDL Init Error: %s\n", SDL_GetError());
         return 1;
     }
+    startup_sdl_ms = startup_elapsed_ms();
+
+    // Sound is optional: with no device the game just plays silently
+    if (!muted && !audio_open())
+    {
+        printf("Continuing without sound.\n");
+    }
 
     // Create window
     window = SDL_CreateWindow(
@@ -102,9 +251,11 @@ int main(int argc, char *argv[])
         return 1;
     }
 
-    // Create renderer with anti-aliasing for smooth shapes
+    // Create renderer with anti-aliasing for smooth shapes. Low-latency
+    // mode paces frames itself instead of queueing behind vsync.
     renderer = SDL_CreateRenderer(window, -1,
-                                  SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+                                  low_latency ? SDL_RENDERER_ACCELERATED
+                                              : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
 
     if (!renderer)
     {
@@ -116,6 +267,7 @@ int main(int argc, char *argv[])
 
     // Set renderer drawing quality
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1");
+    startup_window_ms = startup_elapsed_ms();
 
     // Initialize font
     if (TTF_Init() == -1)
@@ -125,80 +277,159 @@ int main(int argc, char *argv[])
     }
     else
     {
-        // Try multiple font locations
-        const char *font_paths[] = {
-            "arial.ttf",
-            "C:/Windows/Fonts/arial.ttf",
-            "C:/Windows/Fonts/arialbd.ttf",
-            NULL};
-
-        for (int i = 0; font_paths[i] != NULL; i++)
+        // The font is packed into the executable, see assets.h
+        SDL_RWops *font_data = asset_open("font");
+        if (font_data)
         {
-            font = TTF_OpenFont(font_paths[i], 24);
-            if (font)
-            {
-                printf("Loaded font from: %s\n", font_paths[i]);
-                break;
-            }
+            font = TTF_OpenFontRW(font_data, 1, 24);
         }
 
         if (!font)
         {
-            printf("Could not load any font. Game will run without text.\n");
+            printf("Could not load the built-in font. Game will run without text.\n");
         }
     }
+    startup_font_ms = startup_elapsed_ms();
 
     // Set up game
     srand(time(NULL));
+    game_seed((uint32_t)time(NULL));
     init_game();
 
+    // 1800 ticks of history with a keyframe every second
+    if (!snapshot_ring_init(&history, 1800, 256 * 1024, 60))
+    {
+        printf("Could not allocate rewind history. Rewind disabled.\n");
+    }
+
+    // Say whether vsync is real: SDL may fall back to a renderer without it
+    if (inject_seconds > 0)
+    {
+        SDL_RendererInfo info;
+        if (SDL_GetRendererInfo(renderer, &info) == 0)
+        {
+            printf("Injecting presses for %d s: %s renderer, vsync %s\n", inject_seconds, info.name,
+                   (info.flags & SDL_RENDERER_PRESENTVSYNC) ? "on" : "off");
+        }
+        if (SDL_InitSubSystem(SDL_INIT_TIMER) < 0 || SDL_AddTimer(20, inject_press, NULL) == 0)
+        {
+            printf("Could not start the press timer: %s\n", SDL_GetError());
+        }
+    }
+
     // Game loop
+    Uint64 frame_ticks = SDL_GetPerformanceFrequency() / 60;
+    frame_deadline = SDL_GetPerformanceCounter();
+
+    // Frames count as steady once nothing has started, ended or rewound
+    // for a second; until then atlases and SDL's buffers may still grow
+    int settled_frames = 0;
+    bool was_won = game_won, was_lost = game_lost;
+    uint32_t last_tick = game_tick;
+
     while (game_running)
     {
+        if (low_latency)
+        {
+            // Wait first, so the input read below is as fresh as it can be
+            // when the frame goes out. A late frame starts the next one now
+            // rather than trying to catch up.
+            wait_until(frame_deadline);
+            Uint64 now = SDL_GetPerformanceCounter();
+            frame_deadline = frame_deadline + frame_ticks > now ? frame_deadline + frame_ticks : now + frame_ticks;
+        }
+
+        alloc_track_phase(ALLOC_PHASE_INPUT);
         handle_input();
-        update_game();
+        alloc_track_phase(ALLOC_PHASE_SIMULATE);
+        if (net_mode)
+        {
+            // The session simulates (and re-simulates) ticks itself
+            net_tick(session, sample_net_input(), SDL_GetTicks());
+        }
+        else
+        {
+            update_game();
+            if (history.capacity > 0)
+            {
+                snapshot_ring_record(&history);
+            }
+        }
+        telemetry_publish(&telemetry);
+        level_trim(&level, level_cursor);
+        alloc_track_phase(ALLOC_PHASE_RENDER);
         render_game();
-        SDL_Delay(16); //60 FPS
-    }
+        alloc_track_phase(ALLOC_PHASE_OTHER);
 
-    cleanup_game();
-    return 0;
-}
+        if (startup_begin)
+        {
+            printf("Startup: SDL %.1f ms, window %.1f ms, font %.1f ms (%.1f inflating), first frame %.1f ms\n",
+                   startup_sdl_ms, startup_window_ms - startup_sdl_ms,
+                   startup_font_ms - startup_window_ms, asset_inflate_ms(), startup_elapsed_ms());
+            startup_begin = 0;
+        }
+        if (!low_latency)
+        {
+            SDL_Delay(16); //60 FPS
+        }
 
-void init_game()
-{
-    // Initialize shooter position (center bottom)
-    shooter_x = SCREEN_WIDTH / 2;
-    shooter_y = SCREEN_HEIGHT - 120;
-
-    // Reset counters
-    bullets_used = 0;
-    bullets_remaining = MAX_BULLETS;
-    score = 0;
-    targets_killed = 0;
-    game_won = false;
-    game_lost = false;
-
-    // Clear bullets
-    for (int i = 0; i < MAX_BULLETS; i++)
-    {
-        bullets[i].active = false;
+        bool transition = game_won != was_won || game_lost != was_lost || game_tick < last_tick;
+        settled_frames = transition ? 0 : settled_frames + 1;
+        was_won = game_won;
+        was_lost = game_lost;
+        last_tick = game_tick;
+        alloc_track_frame_end(settled_frames > 60);
     }
 
-    // Create targets at random positions
-    for (int i = 0; i < TARGET_COUNT; i++)
+    if (net_mode)
+    {
+        net_print_stats(session, SDL_GetTicks(), stdout);
+    }
+    else if (history.capacity > 0)
+    {
+        printf("Rewind history: %.1f KB per second of play\n",
+               snapshot_ring_bytes_per_second(&history, 60) / 1024.0);
+    }
+    if (frame_queue.frames > 0)
     {
-        spawn_target(i);
+        printf("Rendering: %.1f draw calls and %.1f state changes per frame\n",
+               (double)frame_queue.total_draw_calls / frame_queue.frames,
+               (double)frame_queue.total_state_changes / frame_queue.frames);
     }
+    print_latency();
+    audio_report(stdout);
+    alloc_track_report(stdout);
+    if (culled_frames > 0)
+    {
+        printf("Culling: %.1f entities drawn, %.1f culled, %.1f slow targets per frame\n",
+               (double)total_drawn / culled_frames, (double)total_culled / culled_frames,
+               (double)total_slow / culled_frames);
+        printf("Collisions: %.1f bullet/target pairs tested per frame\n", (double)total_pairs / culled_frames);
+    }
+
+    cleanup_game();
+    return 0;
 }
 
 void cleanup_game()
 {
-    // Cleanup font
+    snapshot_ring_free(&history);
+    telemetry_close(&telemetry);
+    level_close(&level);
+    if (session)
+    {
+        net_close(session);
+        free(session);
+    }
+
+    // Cleanup font, then the memory it was reading from
+    audio_close();
+    free_glyph_atlases();
     if (font)
     {
         TTF_CloseFont(font);
     }
+    assets_free();
 
     // Cleanup renderer and window
     if (renderer)
@@ -215,25 +446,6 @@ void cleanup_game()
     SDL_Quit();
 }
 
-void reset_game()
-{
-    init_game();
-}
-
-void spawn_target(int index)
-{
-    // Position targets randomly in upper half of screen
-    targets[index].x = 50 + (rand() % (SCREEN_WIDTH - 100));
-    targets[index].y = 50 + (rand() % 200);
-
-    // Random movement direction
-    targets[index].dx = (rand() % 5) - 2; 
-    targets[index].dy = (rand() % 5) - 2;
-
-    targets[index].active = true;
-    targets[index].hits = 0;
-}
-
 void handle_input()
 {
     SDL_Event event;
@@ -246,6 +458,11 @@ void handle_input()
         }
         else if (event.type == SDL_KEYDOWN)
         {
+            // Key repeat is not a new press, and held keys move the shooter
+            // below, not here
+            if (!event.key.repeat)
+                note_press(event.key.timestamp);
+
             switch (event.key.keysym.sym)
             {
             case SDLK_ESCAPE:
@@ -253,28 +470,43 @@ void handle_input()
                 break;
             case SDLK_LEFT:
             case SDLK_a:
-                shooter_x -= SHOOTER_SPEED;
-                if (shooter_x < 40)
-                    shooter_x = 40;
+                if (net_mode)
+                    net_presses |= INPUT_LEFT;
+                else
+                    local_taps |= INPUT_LEFT;
                 break;
             case SDLK_RIGHT:
             case SDLK_d:
-                shooter_x += SHOOTER_SPEED;
-                if (shooter_x > SCREEN_WIDTH - 40)
-                    shooter_x = SCREEN_WIDTH - 40;
+                if (net_mode)
+                    net_presses |= INPUT_RIGHT;
+                else
+                    local_taps |= INPUT_RIGHT;
                 break;
             case SDLK_SPACE:
-                if (!game_won && !game_lost)
+                if (net_mode)
+                {
+                    net_presses |= INPUT_FIRE;
+                }
+                else if (!game_won && !game_lost)
                 {
                     shoot_bullet();
                 }
                 break;
             case SDLK_r:
-                if (game_won || game_lost)
+                if (net_mode)
+                {
+                    net_presses |= INPUT_RESET;
+                }
+                else if (game_won || game_lost)
                 {
                     reset_game();
+                    snapshot_ring_clear(&history);
                 }
                 break;
+            case SDLK_BACKSPACE:
+                if (!net_mode)
+                    rewind_game(60); // undo the last second
+                break;
             case SDLK_q:
                 game_running = false;
                 break;
@@ -282,200 +514,224 @@ void handle_input()
         }
     }
 
-    // Continuous movement for smooth controls
+    // In co-op movement goes through the session as input bits
+    if (net_mode)
+        return;
+
+    // Continuous movement for smooth controls, one step per frame for a
+    // held key or a tap
     const Uint8 *keystate = SDL_GetKeyboardState(NULL);
-    if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A])
+    if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A] || (local_taps & INPUT_LEFT))
     {
-        shooter_x -= SHOOTER_SPEED;
-        if (shooter_x < 40)
-            shooter_x = 40;
+        move_shooter(-SHOOTER_SPEED);
     }
-    if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D])
+    if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D] || (local_taps & INPUT_RIGHT))
     {
-        shooter_x += SHOOTER_SPEED;
-        if (shooter_x > SCREEN_WIDTH - 40)
-            shooter_x = SCREEN_WIDTH - 40;
+        move_shooter(SHOOTER_SPEED);
     }
+    local_taps = 0;
 }
 
-void shoot_bullet()
+void note_press(Uint32 timestamp)
 {
-    if (bullets_remaining <= 0)
-        return;
-
-    // Find first inactive bullet
-    for (int i = 0; i < MAX_BULLETS; i++)
-    {
-        if (!bullets[i].active)
-        {
-            bullets[i].x = shooter_x;
-            bullets[i].y = shooter_y - 20; // Start from tip of triangle
-            bullets[i].active = true;
-
-            bullets_used++;
-            bullets_remaining--;
-            break;
-        }
-    }
+    if (pending_count < LATENCY_MAX_PENDING)
+        pending_presses[pending_count++] = timestamp;
 }
 
-void update_game()
+void note_present()
 {
-    if (game_won || game_lost)
-        return;
-
-    // Update bullets - move upward
-    for (int i = 0; i < MAX_BULLETS; i++)
+    // Everything pending was read before this frame was simulated, so
+    // this is the first present that shows it
+    Uint32 now = SDL_GetTicks();
+    for (int i = 0; i < pending_count; i++)
     {
-        if (bullets[i].active)
-        {
-            bullets[i].y -= BULLET_SPEED;
-
-            // Remove bullet if off screen
-            if (bullets[i].y < 0)
-            {
-                bullets[i].active = false;
-            }
-        }
+        Uint32 ms = now - pending_presses[i];
+        latency_ms[latency_count % LATENCY_MAX_SAMPLES] = ms > 65535 ? 65535 : (Uint16)ms;
+        latency_count++;
     }
+    pending_count = 0;
+}
 
-    // Update targets
-    for (int i = 0; i < TARGET_COUNT; i++)
-    {
-        if (targets[i].active)
-        {
-            // Move target
-            targets[i].x += targets[i].dx;
-            targets[i].y += targets[i].dy;
+static int compare_latency(const void *a, const void *b)
+{
+    return *(const Uint16 *)a - *(const Uint16 *)b;
+}
 
-            // Bounce off walls
-            if (targets[i].x < 30 || targets[i].x > SCREEN_WIDTH - 30)
-            {
-                targets[i].dx *= -1;
-            }
-            if (targets[i].y < 30 || targets[i].y > SCREEN_HEIGHT - 150)
-            { // Adjusted bottom boundary
-                targets[i].dy *= -1;
-            }
+void print_latency()
+{
+    if (latency_count == 0)
+        return;
 
-            // If out of bullets, targets attack (move toward shooter)
-            if (bullets_remaining <= 0)
-            {
-                // Move down faster
-                targets[i].y += 3;
+    static Uint16 sorted[LATENCY_MAX_SAMPLES];
+    int n = latency_count < LATENCY_MAX_SAMPLES ? (int)latency_count : LATENCY_MAX_SAMPLES;
+    memcpy(sorted, latency_ms, n * sizeof(Uint16));
+    qsort(sorted, n, sizeof(Uint16), compare_latency);
 
-                // Move horizontally toward shooter
-                if (targets[i].x < shooter_x)
-                {
-                    targets[i].dx = 2;
-                }
-                else if (targets[i].x > shooter_x)
-                {
-                    targets[i].dx = -2;
-                }
+    printf("Input to present (%s, %d presses): p50 %u ms, p90 %u ms, p99 %u ms, max %u ms\n",
+           low_latency ? "low latency" : "vsync", n,
+           sorted[n / 2], sorted[n * 90 / 100], sorted[n * 99 / 100], sorted[n - 1]);
+}
 
-                // Check if target reached shooter (game over)
-                if (targets[i].y > SCREEN_HEIGHT - 130)
-                {
-                    game_lost = true;
-                }
-            }
-        }
-    }
+// Runs on SDL's timer thread; SDL_PushEvent is safe from there. The
+// uneven gaps spread the presses over every point in the frame.
+Uint32 SDLCALL inject_press(Uint32 interval, void *param)
+{
+    (void)interval;
+    (void)param;
+    static Uint32 stop_at = 0;
+    static Uint32 rng = 0x9e3779b9;
 
-    // Check collisions
-    check_collisions();
+    Uint32 now = SDL_GetTicks();
+    if (stop_at == 0)
+        stop_at = now + (Uint32)inject_seconds * 1000;
 
-    // Check win condition
-    if (targets_killed >= TARGET_COUNT)
+    SDL_Event event;
+    SDL_zero(event);
+    if ((Sint32)(now - stop_at) >= 0)
     {
-        game_won = true;
-        score = calculate_score();
+        event.type = SDL_QUIT;
+        SDL_PushEvent(&event);
+        return 0;
     }
+    event.type = SDL_KEYDOWN;
+    event.key.timestamp = now;
+    event.key.keysym.sym = INJECT_KEY;
+    SDL_PushEvent(&event);
+
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return 20 + rng % 40;
+}
 
-    // Check lose condition (out of bullets)
-    if (bullets_remaining <= 0)
+void wait_until(Uint64 deadline)
+{
+    // Sleep while there is time to spare, then spin the last couple of
+    // milliseconds; SDL_Delay alone can oversleep by a whole scheduler tick
+    Uint64 spin = SDL_GetPerformanceFrequency() / 500;
+    for (;;)
     {
-        // Check if any bullets are still active
-        bool any_bullets_active = false;
-        for (int i = 0; i < MAX_BULLETS; i++)
-        {
-            if (bullets[i].active)
-            {
-                any_bullets_active = true;
-                break;
-            }
-        }
-
-        // If no bullets active and not all targets killed, game over
-        if (!any_bullets_active && targets_killed < TARGET_COUNT)
-        {
-            game_lost = true;
-        }
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (now >= deadline)
+            return;
+        if (deadline - now > spin)
+            SDL_Delay(1);
     }
 }
 
-void check_collisions()
+double startup_elapsed_ms()
 {
-    for (int i = 0; i < MAX_BULLETS; i++)
-    {
-        if (!bullets[i].active)
-            continue;
+    return (SDL_GetPerformanceCounter() - startup_begin) * 1000.0 / SDL_GetPerformanceFrequency();
+}
 
-        for (int j = 0; j < TARGET_COUNT; j++)
-        {
-            if (!targets[j].active)
-                continue;
+// Sound wants events as they happen on screen, predicted or not. In co-op
+// the record only takes them once the partner's input is known, stamped
+// with the tick they happened on rather than the one being predicted.
+void on_game_event(GameEventType type, int index)
+{
+    if (!net_mode)
+        telemetry_event(&telemetry, game_tick, type, index);
+    audio_game_event(type);
+}
 
-            // Calculate distance between bullet and target center
-            float dx = bullets[i].x - targets[j].x;
-            float dy = bullets[i].y - targets[j].y;
-            float distance = sqrtf(dx * dx + dy * dy);
+void on_confirmed_event(uint32_t tick, GameEventType type, int index)
+{
+    telemetry_event(&telemetry, tick, type, index);
+}
 
-            // Oval collision detection (approximate with circle for simplicity)
-            if (distance < 25)
-            { // Collision radius for oval
-                bullets[i].active = false;
-                targets[j].hits++;
+uint8_t sample_net_input()
+{
+    const Uint8 *keystate = SDL_GetKeyboardState(NULL);
+    uint8_t input = net_presses;
+    net_presses = 0;
 
-                if (targets[j].hits >= 2)
-                {
-                    targets[j].active = false;
-                    targets_killed++;
-                    score += 10; // Base points for killing a target
-                }
-                break;
-            }
-        }
-    }
+    if (keystate[SDL_SCANCODE_LEFT] || keystate[SDL_SCANCODE_A])
+        input |= INPUT_LEFT;
+    if (keystate[SDL_SCANCODE_RIGHT] || keystate[SDL_SCANCODE_D])
+        input |= INPUT_RIGHT;
+    return input;
 }
 
-int calculate_score()
+bool start_net(int argc, char *argv[])
 {
-    // As per requirements: 20 bullets = 100 score, 50 bullets = 0 score
-    if (bullets_used <= 20)
+    const char *host = NULL;
+    int port = NET_DEFAULT_PORT;
+    int latency = 0, jitter = 0, loss = 0;
+    bool hosting = false;
+    static char host_name[256];
+
+    for (int i = 1; i < argc; i++)
     {
-        return 100;
+        if (strcmp(argv[i], "--host") == 0)
+        {
+            hosting = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--join") == 0 && i + 1 < argc)
+        {
+            // host or host:port
+            snprintf(host_name, sizeof(host_name), "%s", argv[++i]);
+            char *colon = strchr(host_name, ':');
+            if (colon)
+            {
+                *colon = '\0';
+                port = atoi(colon + 1);
+            }
+            host = host_name;
+        }
+        else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc)
+            latency = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc)
+            jitter = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc)
+            loss = atoi(argv[++i]);
     }
 
-    if (bullets_used >= 50)
+    if (!hosting && !host)
+        return true;
+
+    session = malloc(sizeof(NetSession));
+    if (!session)
+        return false;
+
+    bool ok = hosting ? net_host(session, (uint16_t)port, (uint32_t)time(NULL))
+                      : net_join(session, host, (uint16_t)port);
+    if (!ok)
     {
-        return 0;
+        printf("Could not %s on port %d\n", hosting ? "host" : "join", port);
+        free(session);
+        session = NULL;
+        return false;
     }
 
-    // Linear decrease: 100 points for 20 bullets, 0 points for 50 bullets
-    int bullets_over_minimum = bullets_used - 20;
-    int max_bullets_over = 50 - 20;
+    net_set_shim(session, latency, jitter, loss);
+    session->confirmed_hook = on_confirmed_event;
+    net_mode = true;
+    printf(hosting ? "Hosting co-op on port %d, waiting for a partner...\n"
+                   : "Joining co-op on port %d...\n", port);
+    return true;
+}
 
-    // Calculate score (100 - (excess bullets * 100 / 30))
-    int calculated_score = 100 - (bullets_over_minimum * 100 / 30);
+void rewind_game(int ticks)
+{
+    uint32_t oldest, newest;
+    if (!snapshot_ring_oldest(&history, &oldest) || !snapshot_ring_newest(&history, &newest))
+        return;
+
+    // Go back as far as asked, or as far as the history reaches
+    uint32_t tick = newest - oldest > (uint32_t)ticks ? newest - ticks : oldest;
 
-    if (calculated_score < 0)
-        calculated_score = 0;
-    if (calculated_score > 100)
-        calculated_score = 100;
+    Uint64 start = SDL_GetPerformanceCounter();
+    bool ok = snapshot_ring_restore(&history, tick);
+    Uint64 end = SDL_GetPerformanceCounter();
 
-    return calculated_score;
+    if (ok)
+    {
+        printf("Rewound to tick %u in %.3f ms (%.1f KB per second of history)\n",
+               tick, (end - start) * 1000.0 / SDL_GetPerformanceFrequency(),
+               snapshot_ring_bytes_per_second(&history, 60) / 1024.0);
+    }
 }
 
 void draw_triangle(int x, int y, int size, SDL_Color color)
@@ -489,31 +745,27 @@ void draw_triangle(int x, int y, int size, SDL_Color color)
         {x, y - size}         // Back to top (to close the triangle)
     };
 
-    // Set color and draw filled triangle
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-
     // Method 1: Draw filled triangle by drawing multiple lines
     // This is a simple approach for filled triangle
     for (int dy = -size; dy <= size; dy++)
     {
         int width = size - abs(dy);
         SDL_Rect line = {x - width, y + dy, width * 2, 1};
-        SDL_RenderFillRect(renderer, &line);
+        render_queue_fill_rect(&frame_queue, LAYER_SHIPS, color, &line);
     }
 
     // Draw triangle outline in a slightly different color for better visibility
-    SDL_SetRenderDrawColor(renderer,
-                           color.r > 200 ? color.r - 50 : color.r + 50,
-                           color.g > 200 ? color.g - 50 : color.g + 50,
-                           color.b > 200 ? color.b - 50 : color.b + 50,
-                           color.a);
-    SDL_RenderDrawLines(renderer, points, 4);
+    SDL_Color outline = {
+        color.r > 200 ? color.r - 50 : color.r + 50,
+        color.g > 200 ? color.g - 50 : color.g + 50,
+        color.b > 200 ? color.b - 50 : color.b + 50,
+        color.a};
+    render_queue_line_strip(&frame_queue, LAYER_SHIP_OUTLINES, outline, points, 4);
 }
 
-void draw_oval(int center_x, int center_y, int width, int height, SDL_Color color)
+void draw_oval(int center_x, int center_y, int width, int height, SDL_Color color, int layer)
 {
     // Draw a filled oval using multiple rectangles (approximation)
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
 
     // Simple oval drawing using filled ellipsoid approximation
     for (int dy = -height; dy <= height; dy++)
@@ -529,16 +781,16 @@ void draw_oval(int center_x, int center_y, int width, int height, SDL_Color colo
                 center_y + dy,
                 current_width * 2,
                 1};
-            SDL_RenderFillRect(renderer, &line);
+            render_queue_fill_rect(&frame_queue, layer, color, &line);
         }
     }
 
-    // Draw oval outline for better visibility
-    SDL_SetRenderDrawColor(renderer,
-                           color.r > 200 ? color.r - 50 : color.r + 50,
-                           color.g > 200 ? color.g - 50 : color.g + 50,
-                           color.b > 200 ? color.b - 50 : color.b + 50,
-                           color.a);
+    // Draw oval outline for better visibility, one layer up
+    SDL_Color outline = {
+        color.r > 200 ? color.r - 50 : color.r + 50,
+        color.g > 200 ? color.g - 50 : color.g + 50,
+        color.b > 200 ? color.b - 50 : color.b + 50,
+        color.a};
 
     // Draw oval outline using multiple points
     const int segments = 40;
@@ -551,73 +803,128 @@ void draw_oval(int center_x, int center_y, int width, int height, SDL_Color colo
         points[i].y = center_y + (int)(height * sin(angle));
     }
 
-    SDL_RenderDrawLines(renderer, points, segments + 1);
+    render_queue_line_strip(&frame_queue, layer + 1, outline, points, segments + 1);
 }
 
-void render_game()
+// True if an entity this far either side of x overlaps the view
+static bool in_view(float x, int half_width)
 {
-    // Clear screen with dark blue (like space)
-    SDL_SetRenderDrawColor(renderer, 10, 10, 40, 255);
-    SDL_RenderClear(renderer);
+    return x + half_width >= camera_x && x - half_width < camera_x + SCREEN_WIDTH;
+}
 
-    // Draw a starfield background (only in game area, not in control panel)
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 100);
-    for (int i = 0; i < 50; i++)
-    {
-        int star_x = rand() % SCREEN_WIDTH;
-        int star_y = rand() % (SCREEN_HEIGHT - 100); // Only in game area
-        SDL_RenderDrawPoint(renderer, star_x, star_y);
-    }
+void draw_world()
+{
+    // Follow our own shooter and stop at the edges of the world
+    int follow_x = net_mode && session->local_player == 1 ? partner_x : shooter_x;
+    camera_x = follow_x - SCREEN_WIDTH / 2;
+    if (camera_x > world_width - SCREEN_WIDTH)
+        camera_x = world_width - SCREEN_WIDTH;
+    if (camera_x < 0)
+        camera_x = 0;
 
     // Draw shooter as GREEN TRIANGLE
     SDL_Color shooter_color = {0, 255, 0, 255}; // Green
-    draw_triangle(shooter_x, shooter_y, 20, shooter_color);
+    if (in_view(shooter_x, 20))
+        draw_triangle(shooter_x - camera_x, shooter_y, 20, shooter_color);
+
+    // Co-op partner as a BLUE TRIANGLE
+    if (player_count > 1 && in_view(partner_x, 20))
+    {
+        SDL_Color partner_color = {0, 150, 255, 255};
+        draw_triangle(partner_x - camera_x, shooter_y, 20, partner_color);
+    }
+
+    // Only the grid cells under the view (plus the widest sprite) are
+    // looked at; the rest of the world is culled without a visit
+    uint32_t target_mask;
+    uint64_t bullet_mask;
+    grid_build(&view_grid);
+    grid_query(&view_grid, camera_x - 21, -21, camera_x + SCREEN_WIDTH + 21, SCREEN_HEIGHT + 21,
+               &target_mask, &bullet_mask);
+
+    int active = 0;
+    view_drawn = 0;
 
     // Draw targets as RED OVALS
-    for (int i = 0; i < TARGET_COUNT; i++)
+    for (int i = 0; i < MAX_TARGETS; i++)
     {
-        if (targets[i].active)
+        if (!targets[i].active)
+            continue;
+        active++;
+        if (!(target_mask & (1u << i)) || !in_view(targets[i].x, 21))
+            continue;
+        view_drawn++;
+
+        // Color: Red for no hits, Orange for one hit
+        SDL_Color target_color;
+        if (targets[i].hits == 0)
         {
-            // Color: Red for no hits, Orange for one hit
-            SDL_Color target_color;
-            if (targets[i].hits == 0)
-            {
-                target_color = (SDL_Color){255, 0, 0, 255}; // Bright red
-            }
-            else
-            {
-                target_color = (SDL_Color){255, 140, 0, 255}; // Orange
-            }
+            target_color = (SDL_Color){255, 0, 0, 255}; // Bright red
+        }
+        else
+        {
+            target_color = (SDL_Color){255, 140, 0, 255}; // Orange
+        }
 
-            // Draw oval target
-            draw_oval((int)targets[i].x, (int)targets[i].y, 20, 15, target_color);
+        // Draw oval target
+        int x = (int)targets[i].x - camera_x;
+        draw_oval(x, (int)targets[i].y, 20, 15, target_color, LAYER_TARGETS);
 
-            // Draw hit indicator (white circle inside oval)
-            if (targets[i].hits > 0)
-            {
-                SDL_Color hit_color = {255, 255, 255, 255};
-                draw_oval((int)targets[i].x, (int)targets[i].y, 8, 6, hit_color);
-            }
+        // Draw hit indicator (white circle inside oval)
+        if (targets[i].hits > 0)
+        {
+            SDL_Color hit_color = {255, 255, 255, 255};
+            draw_oval(x, (int)targets[i].y, 8, 6, hit_color, LAYER_HIT_MARKS);
         }
     }
 
     // Draw bullets as YELLOW RECTANGLES (laser beams)
-    SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+    SDL_Color laser_color = {255, 255, 0, 255};
     for (int i = 0; i < MAX_BULLETS; i++)
     {
-        if (bullets[i].active)
-        {
-            // Draw laser beam
-            SDL_Rect laser_core = {
-                (int)bullets[i].x - 2,
-                (int)bullets[i].y - 15,
-                4,
-                30};
-            SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
-            SDL_RenderFillRect(renderer, &laser_core);
-        }
+        if (!bullets[i].active)
+            continue;
+        active++;
+        if (!(bullet_mask & (1ull << i)) || !in_view(bullets[i].x, 2))
+            continue;
+        view_drawn++;
+
+        // Draw laser beam
+        SDL_Rect laser_core = {
+            (int)bullets[i].x - 2 - camera_x,
+            (int)bullets[i].y - 15,
+            4,
+            30};
+        render_queue_fill_rect(&frame_queue, LAYER_BULLETS, laser_color, &laser_core);
     }
 
+    view_culled = active - view_drawn;
+    total_drawn += view_drawn;
+    total_culled += view_culled;
+    total_slow += targets_slow;
+    total_pairs += collision_pairs;
+    culled_frames++;
+}
+
+void render_game()
+{
+    // Clear screen with dark blue (like space)
+    SDL_SetRenderDrawColor(renderer, 10, 10, 40, 255);
+    SDL_RenderClear(renderer);
+
+    // Draw a starfield background (only in game area, not in control panel)
+    SDL_Point stars[50];
+    for (int i = 0; i < 50; i++)
+    {
+        stars[i].x = rand() % SCREEN_WIDTH;
+        stars[i].y = rand() % (SCREEN_HEIGHT - 100); // Only in game area
+    }
+    SDL_Color star_color = {255, 255, 255, 100};
+    render_queue_points(&frame_queue, LAYER_STARS, star_color, stars, 50);
+
+    // Ships, targets and bullets, as seen through the camera
+    draw_world();
+
     // Draw UI text if font is available
     if (font)
     {
@@ -630,9 +937,8 @@ void render_game()
         char buffer[100];
 
         // ===== GAME STATS PANEL (Top Left - Always Visible) =====
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
         SDL_Rect stats_panel = {5, 5, 250, 90};
-        SDL_RenderFillRect(renderer, &stats_panel);
+        fill_rect((SDL_Color){0, 0, 0, 180}, &stats_panel);
 
         // Stats title
         render_text("GAME STATUS", 10, 10, blue);
@@ -642,21 +948,38 @@ void render_game()
         render_text(buffer, 20, 35, white);
 
         // Targets counter
-        snprintf(buffer, sizeof(buffer), "TARGETS: %d/%d", targets_killed, TARGET_COUNT);
+        snprintf(buffer, sizeof(buffer), "TARGETS: %d/%d", targets_killed, targets_total);
         render_text(buffer, 20, 60, white);
 
         // Score
         snprintf(buffer, sizeof(buffer), "SCORE: %d", score);
         render_text(buffer, 20, 85, yellow);
 
+        // ===== WORLD VIEW (Top Right - Only in a wide world) =====
+        if (world_width > SCREEN_WIDTH || far_target_lod)
+        {
+            SDL_Rect view_panel = {SCREEN_WIDTH - 345, 5, 340, 90};
+            fill_rect((SDL_Color){0, 0, 0, 180}, &view_panel);
+
+            // Where the view sits in the world
+            SDL_Rect world_bar = {SCREEN_WIDTH - 335, 15, 320, 8};
+            SDL_Rect view_bar = {world_bar.x + camera_x * world_bar.w / world_width, world_bar.y,
+                                 SCREEN_WIDTH * world_bar.w / world_width, world_bar.h};
+            outline_rect(blue, &world_bar);
+            render_queue_fill_rect(&frame_queue, LAYER_PANEL_FG, blue, &view_bar);
+
+            snprintf(buffer, sizeof(buffer), "DRAWN %d  CULLED %d  SLOW %d", view_drawn, view_culled, targets_slow);
+            render_text(buffer, SCREEN_WIDTH - 335, 35, white);
+            snprintf(buffer, sizeof(buffer), "PAIRS TESTED %d", (int)collision_pairs);
+            render_text(buffer, SCREEN_WIDTH - 335, 60, white);
+        }
+
         // ===== PERMANENT CONTROLS PANEL (Bottom - Always Visible) =====
-        SDL_SetRenderDrawColor(renderer, 20, 20, 40, 240);
         SDL_Rect controls_panel = {0, SCREEN_HEIGHT - 100, SCREEN_WIDTH, 100};
-        SDL_RenderFillRect(renderer, &controls_panel);
+        fill_rect((SDL_Color){20, 20, 40, 240}, &controls_panel);
 
         // Panel border
-        SDL_SetRenderDrawColor(renderer, 0, 150, 255, 255);
-        SDL_RenderDrawRect(renderer, &controls_panel);
+        outline_rect((SDL_Color){0, 150, 255, 255}, &controls_panel);
 
         // Controls title
         render_text("CONTROLS (Always Active)", 20, SCREEN_HEIGHT - 95, green);
@@ -678,17 +1001,15 @@ void render_game()
         if (game_won)
         {
             // Victory overlay - semi-transparent over game area only
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
             SDL_Rect overlay = {
                 SCREEN_WIDTH / 2 - 200,
                 SCREEN_HEIGHT / 2 - 150, // Centered in game area
                 400,
                 200};
-            SDL_RenderFillRect(renderer, &overlay);
+            fill_rect((SDL_Color){0, 0, 0, 200}, &overlay);
 
             // Draw victory border
-            SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-            SDL_RenderDrawRect(renderer, &overlay);
+            outline_rect((SDL_Color){0, 255, 0, 255}, &overlay);
 
             render_text("VICTORY!", SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 - 130, green);
 
@@ -703,17 +1024,15 @@ void render_game()
         else if (game_lost)
         {
             // Game over overlay
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
             SDL_Rect overlay = {
                 SCREEN_WIDTH / 2 - 200,
                 SCREEN_HEIGHT / 2 - 150, // Centered in game area
                 400,
                 200};
-            SDL_RenderFillRect(renderer, &overlay);
+            fill_rect((SDL_Color){0, 0, 0, 200}, &overlay);
 
             // Draw danger border
-            SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-            SDL_RenderDrawRect(renderer, &overlay);
+            outline_rect((SDL_Color){255, 0, 0, 255}, &overlay);
 
             render_text("GAME OVER", SCREEN_WIDTH / 2 - 60, SCREEN_HEIGHT / 2 - 130, red);
             render_text("Out of bullets!", SCREEN_WIDTH / 2 - 70, SCREEN_HEIGHT / 2 - 90, white);
@@ -724,20 +1043,102 @@ void render_game()
     else
     {
         // Fallback if no font
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+        SDL_Color white = {255, 255, 255, 255};
         SDL_Rect bullets_text = {10, 10, 150, 20};
-        SDL_RenderDrawRect(renderer, &bullets_text);
+        outline_rect(white, &bullets_text);
 
         SDL_Rect targets_text = {10, 40, 150, 20};
-        SDL_RenderDrawRect(renderer, &targets_text);
+        outline_rect(white, &targets_text);
 
         // Draw control panel separator line
-        SDL_SetRenderDrawColor(renderer, 0, 150, 255, 255);
-        SDL_RenderDrawLine(renderer, 0, SCREEN_HEIGHT - 100, SCREEN_WIDTH, SCREEN_HEIGHT - 100);
+        SDL_Point separator[2] = {{0, SCREEN_HEIGHT - 100}, {SCREEN_WIDTH, SCREEN_HEIGHT - 100}};
+        render_queue_line_strip(&frame_queue, LAYER_PANEL_BORDERS, (SDL_Color){0, 150, 255, 255}, separator, 2);
     }
 
-    // Update screen
+    // Draw the whole frame in as few calls as possible, then update screen
+    alloc_track_phase(ALLOC_PHASE_PRESENT);
+    render_queue_flush(&frame_queue, renderer);
     SDL_RenderPresent(renderer);
+    note_present();
+}
+
+void fill_rect(SDL_Color color, const SDL_Rect *rect)
+{
+    render_queue_fill_rect(&frame_queue, LAYER_PANELS, color, rect);
+}
+
+void outline_rect(SDL_Color color, const SDL_Rect *rect)
+{
+    render_queue_outline_rect(&frame_queue, LAYER_PANEL_BORDERS, color, rect);
+}
+
+SDL_Texture *glyph_atlas(SDL_Color color)
+{
+    for (int i = 0; i < glyph_atlas_count; i++)
+    {
+        SDL_Color c = glyph_atlases[i].color;
+        if (c.r == color.r && c.g == color.g && c.b == color.b && c.a == color.a)
+            return glyph_atlases[i].texture;
+    }
+    if (glyph_atlas_count == MAX_TEXT_COLORS)
+        return NULL;
+
+    // Render every glyph, then lay them out in a row
+    SDL_Surface *glyphs[GLYPH_COUNT];
+    int width = 0, height = 0;
+    for (int g = 0; g < GLYPH_COUNT; g++)
+    {
+        glyphs[g] = TTF_RenderGlyph_Solid(font, (Uint16)(GLYPH_FIRST + g), color);
+        int w = glyphs[g] ? glyphs[g]->w : 0;
+        int h = glyphs[g] ? glyphs[g]->h : 0;
+        glyph_rects[g] = (SDL_Rect){width, 0, w, h};
+        width += w;
+        if (h > height)
+            height = h;
+
+        if (TTF_GlyphMetrics(font, (Uint16)(GLYPH_FIRST + g), NULL, NULL, NULL, NULL, &glyph_advance[g]) != 0)
+            glyph_advance[g] = w;
+    }
+
+    SDL_Texture *texture = NULL;
+    SDL_Surface *atlas = width > 0 ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32) : NULL;
+    if (atlas)
+    {
+        // Starts fully transparent; the glyphs' colour key keeps their
+        // background out
+        for (int g = 0; g < GLYPH_COUNT; g++)
+        {
+            if (glyphs[g])
+            {
+                SDL_Rect at = glyph_rects[g];
+                SDL_BlitSurface(glyphs[g], NULL, atlas, &at);
+            }
+        }
+        texture = SDL_CreateTextureFromSurface(renderer, atlas);
+        if (texture)
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        SDL_FreeSurface(atlas);
+    }
+    for (int g = 0; g < GLYPH_COUNT; g++)
+    {
+        SDL_FreeSurface(glyphs[g]);
+    }
+
+    if (!texture)
+        return NULL;
+    glyph_atlases[glyph_atlas_count].color = color;
+    glyph_atlases[glyph_atlas_count].texture = texture;
+    glyph_atlas_count++;
+    return texture;
+}
+
+void free_glyph_atlases()
+{
+    for (int i = 0; i < glyph_atlas_count; i++)
+    {
+        SDL_DestroyTexture(glyph_atlases[i].texture);
+    }
+    glyph_atlas_count = 0;
 }
 
 void render_text(const char *text, int x, int y, SDL_Color color)
@@ -745,20 +1146,23 @@ void render_text(const char *text, int x, int y, SDL_Color color)
     if (!font)
         return;
 
-    SDL_Surface *surface = TTF_RenderText_Solid(font, text, color);
-    if (!surface)
+    SDL_Texture *atlas = glyph_atlas(color);
+    if (!atlas)
         return;
 
-    SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (!texture)
+    // One quad per glyph, all from the same texture, so the queue draws a
+    // colour's text back to back
+    for (const char *c = text; *c; c++)
     {
-        SDL_FreeSurface(surface);
-        return;
-    }
-
-    SDL_Rect dest_rect = {x, y, surface->w, surface->h};
-    SDL_RenderCopy(renderer, texture, NULL, &dest_rect);
+        int g = (unsigned char)*c - GLYPH_FIRST;
+        if (g < 0 || g >= GLYPH_COUNT)
+            g = 0; // anything unprintable takes up a space
 
-    SDL_DestroyTexture(texture);
-    SDL_FreeSurface(surface);
-}
\ No newline at end of file
+        if (glyph_rects[g].w > 0)
+        {
+            SDL_Rect dest_rect = {x, y, glyph_rects[g].w, glyph_rects[g].h};
+            render_queue_texture(&frame_queue, LAYER_TEXT, atlas, false, &glyph_rects[g], &dest_rect);
+        }
+        x += glyph_advance[g];
+    }
+}
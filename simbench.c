@@ -0,0 +1,301 @@
+// simbench.c
+// Times the simulation kernels (step_bullets, step_targets, collide) on
+// large entity arrays, once per game mode, and hashes a batch of full games
+// so two builds can be checked for identical results. A second table times
+// step_targets alone on a mix of behaviours with some slots inactive, the
+// lanes the all-bouncing arrays never take. build_game.sh builds
+// it twice: simbench with float entities and simbench_fixed with
+// -DGAME_FIXED_POINT.
+//
+// usage: simbench [--ticks T] [--games G] [--seed S]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "game.h"
+#include "snapshot.h"
+
+#ifdef GAME_FIXED_POINT
+#define BUILD_NAME "fixed"
+#else
+#define BUILD_NAME "float"
+#endif
+
+// Bullets in the collision test. One set is level with the targets but off
+// the left edge, so every pair is tested and nothing changes between
+// passes; the other sits in the sky above the field, where the pass skips
+// them without testing a pair.
+#define COLLIDE_BULLETS 64
+
+static double seconds_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_targets(Target *list, int count)
+{
+    // Same distribution as spawn_target()
+    for (int i = 0; i < count; i++)
+    {
+        list[i].x = 50 + (game_rand() % (SCREEN_WIDTH - 100));
+        list[i].y = 50 + (game_rand() % 200);
+        list[i].dx = (game_rand() % 5) - 2;
+        list[i].dy = (game_rand() % 5) - 2;
+        list[i].active = true;
+        list[i].hits = 0;
+        list[i].hit_points = 2;
+        list[i].behaviour = BEHAVIOUR_BOUNCE;
+    }
+}
+
+// Every behaviour, and a quarter of the slots empty as in a thinning wave
+static void fill_mixed_targets(Target *list, int count)
+{
+    fill_targets(list, count);
+    for (int i = 0; i < count; i++)
+    {
+        list[i].behaviour = game_rand() % BEHAVIOUR_COUNT;
+        list[i].active = game_rand() % 4 != 0;
+    }
+}
+
+static void fill_bullets(Bullet *list, int count, bool above_field)
+{
+    for (int i = 0; i < count; i++)
+    {
+        list[i].x = game_rand() % SCREEN_WIDTH;
+        list[i].y = above_field ? -1000 : SCREEN_HEIGHT - 140 - (game_rand() % 500);
+        list[i].active = true;
+    }
+}
+
+static uint32_t hash_bytes(uint32_t h, const void *data, size_t size)
+{
+    // FNV-1a, as in snapshot_checksum()
+    const uint8_t *p = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static uint32_t hash_targets(uint32_t h, const Target *list, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int32_t v[6] = {(int32_t)list[i].x, (int32_t)list[i].y, (int32_t)list[i].dx, (int32_t)list[i].dy,
+                        list[i].active, list[i].hits};
+        h = hash_bytes(h, v, sizeof(v));
+    }
+    return h;
+}
+
+static void bench_size(int count, int ticks)
+{
+    Target *target_list = malloc(sizeof(Target) * count);
+    Target *attack_list = malloc(sizeof(Target) * count);
+    Bullet *bullet_list = malloc(sizeof(Bullet) * count);
+    Bullet high[COLLIDE_BULLETS], beside[COLLIDE_BULLETS];
+    if (!target_list || !attack_list || !bullet_list)
+    {
+        printf("%9d  out of memory\n", count);
+        free(target_list);
+        free(attack_list);
+        free(bullet_list);
+        return;
+    }
+
+    fill_targets(target_list, count);
+    fill_bullets(bullet_list, count, false);
+    fill_bullets(high, COLLIDE_BULLETS, true);
+    for (int i = 0; i < COLLIDE_BULLETS; i++)
+    {
+        beside[i].x = -1000;
+        beside[i].y = 50 + (i * 7) % 200;
+        beside[i].active = true;
+    }
+    memcpy(attack_list, target_list, sizeof(Target) * count);
+
+    // Movement: every entity every tick. Bullets that leave the top are
+    // put back so the work stays the same.
+    double move_seconds = 0;
+    for (int t = 0; t < ticks; t++)
+    {
+        double start = seconds_now();
+        step_bullets(bullet_list, count);
+        step_targets_mode(GAME_MODE_NORMAL, target_list, count);
+        move_seconds += seconds_now() - start;
+
+        if ((t & 31) == 31)
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (!bullet_list[i].active)
+                {
+                    bullet_list[i].y = SCREEN_HEIGHT - 140;
+                    bullet_list[i].active = true;
+                }
+            }
+        }
+    }
+
+    // The same with the targets attacking. They dive off the bottom, which
+    // costs the kernel nothing extra.
+    double attack_seconds = 0;
+    for (int t = 0; t < ticks; t++)
+    {
+        double start = seconds_now();
+        step_bullets(bullet_list, count);
+        step_targets_mode(GAME_MODE_ATTACK, attack_list, count);
+        attack_seconds += seconds_now() - start;
+    }
+    game_lost = false;
+
+    // Game over: what a decided tick's kernels cost, which should be nothing
+    double over_seconds = 0;
+    for (int t = 0; t < ticks; t++)
+    {
+        double start = seconds_now();
+        step_targets_mode(GAME_MODE_OVER, target_list, count);
+        collide_mode(GAME_MODE_OVER, high, COLLIDE_BULLETS, target_list, count);
+        over_seconds += seconds_now() - start;
+    }
+
+    // Collision: a fixed bullet count against all targets
+    int passes = ticks / 4 > 0 ? ticks / 4 : 1;
+    uint64_t pairs = 0;
+    double start = seconds_now();
+    for (int p = 0; p < passes; p++)
+    {
+        collide_mode(GAME_MODE_NORMAL, beside, COLLIDE_BULLETS, target_list, count);
+        pairs += collision_pairs;
+    }
+    double collide_seconds = seconds_now() - start;
+
+    start = seconds_now();
+    for (int p = 0; p < passes; p++)
+        collide_mode(GAME_MODE_NORMAL, high, COLLIDE_BULLETS, target_list, count);
+    double sky_seconds = seconds_now() - start;
+
+    // Hash values, not bytes, since the two builds lay targets out differently
+    uint32_t h = hash_targets(2166136261u, target_list, count);
+    double entity_ticks = (double)count * 2 * ticks;
+    printf("%9d %10.2f %10.2f %10.2f %10.1f %10.1f %10.1f    %08x\n", count,
+           move_seconds * 1e9 / entity_ticks, attack_seconds * 1e9 / entity_ticks,
+           over_seconds * 1e9 / entity_ticks, pairs / collide_seconds / 1e6,
+           (double)COLLIDE_BULLETS * count * passes / sky_seconds / 1e6,
+           (sizeof(Target) + sizeof(Bullet)) * (double)count / 1024,
+           h);
+
+    free(target_list);
+    free(attack_list);
+    free(bullet_list);
+}
+
+// Targets only, so the figures are per target rather than per entity
+static void bench_mixed(int count, int ticks)
+{
+    Target *normal_list = malloc(sizeof(Target) * count);
+    Target *attack_list = malloc(sizeof(Target) * count);
+    if (!normal_list || !attack_list)
+    {
+        printf("%9d  out of memory\n", count);
+        free(normal_list);
+        free(attack_list);
+        return;
+    }
+    fill_mixed_targets(normal_list, count);
+    memcpy(attack_list, normal_list, sizeof(Target) * count);
+
+    double start = seconds_now();
+    for (int t = 0; t < ticks; t++)
+        step_targets_mode(GAME_MODE_NORMAL, normal_list, count);
+    double normal_seconds = seconds_now() - start;
+
+    start = seconds_now();
+    for (int t = 0; t < ticks; t++)
+        step_targets_mode(GAME_MODE_ATTACK, attack_list, count);
+    double attack_seconds = seconds_now() - start;
+    game_lost = false;
+
+    uint32_t h = hash_targets(2166136261u, normal_list, count);
+    h = hash_targets(h, attack_list, count);
+    printf("%9d %10.2f %10.2f    %08x\n", count, normal_seconds * 1e9 / ((double)count * ticks),
+           attack_seconds * 1e9 / ((double)count * ticks), h);
+
+    free(normal_list);
+    free(attack_list);
+}
+
+// Plays games with a fixed input pattern and hashes every tick's snapshot
+static uint32_t hash_games(int games, uint32_t seed)
+{
+    uint8_t state[SNAPSHOT_SIZE];
+    uint32_t h = 2166136261u;
+
+    for (int g = 0; g < games; g++)
+    {
+        game_seed(seed + (uint32_t)g * 7919u);
+        init_game();
+
+        uint32_t rng = seed ^ (uint32_t)g;
+        while (!game_won && !game_lost && game_tick < 20000)
+        {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            apply_input(0, (uint8_t)(rng & (INPUT_LEFT | INPUT_RIGHT | INPUT_FIRE)));
+            update_game();
+
+            snapshot_save(state);
+            h = hash_bytes(h, state, sizeof(state));
+        }
+    }
+    return h;
+}
+
+int main(int argc, char *argv[])
+{
+    int ticks = 200;
+    int games = 200;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "--ticks") == 0)
+            ticks = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--games") == 0)
+            games = atoi(argv[++i]);
+        else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0)
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+    }
+
+    printf("%s build: Target %zu bytes, Bullet %zu bytes\n", BUILD_NAME, sizeof(Target), sizeof(Bullet));
+    printf("%9s %32s %21s %10s    %s\n", "", "move ns/ent by mode", "collide Mpairs/s", "", "");
+    printf("%9s %10s %10s %10s %10s %10s %10s    %s\n", "entities", "normal", "attack", "over", "tested", "sky",
+           "KB", "state");
+
+    static const int sizes[] = {1000, 10000, 100000, 1000000};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        game_seed(seed);
+        bench_size(sizes[s], ticks);
+    }
+
+    printf("%9s %21s\n", "", "mixed targets: ns/target");
+    printf("%9s %10s %10s    %s\n", "targets", "normal", "attack", "state");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        game_seed(seed);
+        bench_mixed(sizes[s], ticks);
+    }
+
+    // Builds that agree print the same hash here
+    printf("games hash over %d games: %08x\n", games, hash_games(games, seed));
+    return 0;
+}
@@ -0,0 +1,470 @@
+// snapshot.c
+// Snapshot serialization and the keyframe + delta rewind ring.
+
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+// ---- little-endian helpers ----
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static const uint8_t *get_u32(const uint8_t *p, uint32_t *v)
+{
+    *v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    return p + 4;
+}
+
+static uint8_t *put_f32(uint8_t *p, float f)
+{
+    // -0 and 0 behave the same in the game; store one of them so float and
+    // fixed-point builds write identical bytes
+    if (f == 0)
+        f = 0;
+
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return put_u32(p, v);
+}
+
+// Returns the value rather than storing through a pointer, so it can be
+// assigned to fixed-point fields too (see GAME_FIXED_POINT)
+static float get_f32(const uint8_t **p)
+{
+    uint32_t v;
+    float f;
+    *p = get_u32(*p, &v);
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static const uint8_t *get_i32(const uint8_t *p, int *i)
+{
+    uint32_t v;
+    p = get_u32(p, &v);
+    *i = (int32_t)v;
+    return p;
+}
+
+// LEB128 varints for the run lengths in deltas
+static uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *v)
+{
+    uint32_t result = 0;
+    int shift = 0;
+    while (p < end && shift < 32)
+    {
+        uint8_t b = *p++;
+        result |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *v = result;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+// ---- single snapshots ----
+
+size_t snapshot_save(uint8_t *out)
+{
+    uint8_t *p = out;
+
+    *p++ = SNAPSHOT_VERSION;
+    p = put_u32(p, game_tick);
+    p = put_u32(p, game_rng);
+    p = put_u32(p, (uint32_t)shooter_x);
+    p = put_u32(p, (uint32_t)shooter_y);
+    p = put_u32(p, (uint32_t)partner_x);
+    p = put_u32(p, (uint32_t)player_count);
+    p = put_u32(p, (uint32_t)bullets_used);
+    p = put_u32(p, (uint32_t)bullets_remaining);
+    p = put_u32(p, (uint32_t)score);
+    p = put_u32(p, (uint32_t)targets_killed);
+    p = put_u32(p, (uint32_t)targets_total);
+    p = put_u32(p, level_cursor);
+    *p++ = (uint8_t)((game_won ? 1 : 0) | (game_lost ? 2 : 0));
+
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        p = put_f32(p, targets[i].x);
+        p = put_f32(p, targets[i].y);
+        p = put_f32(p, targets[i].dx);
+        p = put_f32(p, targets[i].dy);
+        // hits never exceeds 15, so the top bit is free for the active flag
+        *p++ = (uint8_t)((targets[i].hits & 0x7f) | (targets[i].active ? 0x80 : 0));
+        *p++ = (uint8_t)((targets[i].hit_points & 0x0f) | (targets[i].behaviour << 4));
+    }
+
+    memset(p, 0, SNAPSHOT_BULLET_MASK_SIZE);
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        if (bullets[i].active)
+            p[i / 8] |= (uint8_t)(1 << (i % 8));
+    }
+    p += SNAPSHOT_BULLET_MASK_SIZE;
+
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        p = put_f32(p, bullets[i].x);
+        p = put_f32(p, bullets[i].y);
+    }
+
+    return (size_t)(p - out);
+}
+
+bool snapshot_load(const uint8_t *in, size_t length)
+{
+    if (length != SNAPSHOT_SIZE || in[0] != SNAPSHOT_VERSION)
+        return false;
+
+    const uint8_t *p = in + 1;
+    p = get_u32(p, &game_tick);
+    p = get_u32(p, &game_rng);
+    p = get_i32(p, &shooter_x);
+    p = get_i32(p, &shooter_y);
+    p = get_i32(p, &partner_x);
+    p = get_i32(p, &player_count);
+    p = get_i32(p, &bullets_used);
+    p = get_i32(p, &bullets_remaining);
+    p = get_i32(p, &score);
+    p = get_i32(p, &targets_killed);
+    p = get_i32(p, &targets_total);
+    p = get_u32(p, &level_cursor);
+    game_won = (*p & 1) != 0;
+    game_lost = (*p & 2) != 0;
+    p++;
+
+    targets_in_use = 0;
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        targets[i].x = get_f32(&p);
+        targets[i].y = get_f32(&p);
+        targets[i].dx = get_f32(&p);
+        targets[i].dy = get_f32(&p);
+        targets[i].hits = *p & 0x7f;
+        targets[i].active = (*p & 0x80) != 0;
+        p++;
+        targets[i].hit_points = *p & 0x0f;
+        targets[i].behaviour = *p >> 4;
+        p++;
+
+        // The high-water mark is not stored, it follows from the pool
+        if (targets[i].active)
+            targets_in_use = i + 1;
+    }
+
+    const uint8_t *mask = p;
+    p += SNAPSHOT_BULLET_MASK_SIZE;
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        bullets[i].active = (mask[i / 8] >> (i % 8)) & 1;
+        bullets[i].x = get_f32(&p);
+        bullets[i].y = get_f32(&p);
+    }
+
+    return true;
+}
+
+uint32_t snapshot_checksum(const uint8_t *state)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < SNAPSHOT_SIZE; i++)
+    {
+        h ^= state[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// ---- deltas ----
+// A delta is a list of (zero run, literal run, literal bytes) triples over
+// base XOR cur. Most of the state is unchanged tick to tick, so the zero
+// runs swallow nearly everything.
+
+size_t snapshot_delta_encode(const uint8_t *base, const uint8_t *cur, uint8_t *out)
+{
+    uint8_t *p = out;
+    int i = 0;
+
+    while (i < SNAPSHOT_SIZE)
+    {
+        int zeros = 0;
+        while (i + zeros < SNAPSHOT_SIZE && base[i + zeros] == cur[i + zeros])
+            zeros++;
+        i += zeros;
+
+        // A literal run ends at the first pair of unchanged bytes; a single
+        // unchanged byte costs less to carry than to start a new triple.
+        int literal = 0;
+        while (i + literal < SNAPSHOT_SIZE)
+        {
+            if (base[i + literal] == cur[i + literal] &&
+                (i + literal + 1 >= SNAPSHOT_SIZE || base[i + literal + 1] == cur[i + literal + 1]))
+                break;
+            literal++;
+        }
+
+        p = put_varint(p, (uint32_t)zeros);
+        p = put_varint(p, (uint32_t)literal);
+        for (int k = 0; k < literal; k++)
+            *p++ = base[i + k] ^ cur[i + k];
+        i += literal;
+    }
+
+    return (size_t)(p - out);
+}
+
+bool snapshot_delta_apply(uint8_t *state, const uint8_t *delta, size_t length)
+{
+    const uint8_t *p = delta;
+    const uint8_t *end = delta + length;
+    uint32_t i = 0;
+
+    while (p < end)
+    {
+        uint32_t zeros, literal;
+        p = get_varint(p, end, &zeros);
+        if (!p)
+            return false;
+        p = get_varint(p, end, &literal);
+        if (!p)
+            return false;
+
+        i += zeros;
+        if (i + literal > SNAPSHOT_SIZE || (size_t)(end - p) < literal)
+            return false;
+        for (uint32_t k = 0; k < literal; k++)
+            state[i + k] ^= *p++;
+        i += literal;
+    }
+
+    return i <= SNAPSHOT_SIZE;
+}
+
+// ---- rewind ring ----
+
+static SnapshotEntry *ring_entry(const SnapshotRing *ring, int n)
+{
+    return &ring->entries[(ring->first + n) % ring->capacity];
+}
+
+bool snapshot_ring_init(SnapshotRing *ring, int max_ticks, uint32_t arena_bytes, int keyframe_interval)
+{
+    memset(ring, 0, sizeof(*ring));
+    if (max_ticks < 1 || keyframe_interval < 1 || arena_bytes < 2 * SNAPSHOT_DELTA_MAX)
+        return false;
+
+    ring->entries = malloc(sizeof(SnapshotEntry) * max_ticks);
+    ring->arena = malloc(arena_bytes);
+    if (!ring->entries || !ring->arena)
+    {
+        snapshot_ring_free(ring);
+        return false;
+    }
+
+    ring->capacity = max_ticks;
+    ring->arena_size = arena_bytes;
+    ring->keyframe_interval = keyframe_interval;
+    return true;
+}
+
+void snapshot_ring_free(SnapshotRing *ring)
+{
+    free(ring->entries);
+    free(ring->arena);
+    ring->entries = NULL;
+    ring->arena = NULL;
+    ring->capacity = 0;
+    ring->count = 0;
+}
+
+void snapshot_ring_clear(SnapshotRing *ring)
+{
+    ring->first = 0;
+    ring->count = 0;
+    ring->arena_head = 0;
+    ring->arena_tail = 0;
+    ring->bytes_stored = 0;
+    ring->since_keyframe = 0;
+}
+
+// Drop the oldest keyframe and every delta that depends on it
+static void ring_drop_oldest_group(SnapshotRing *ring)
+{
+    do
+    {
+        ring->bytes_stored -= ring_entry(ring, 0)->length;
+        ring->first = (ring->first + 1) % ring->capacity;
+        ring->count--;
+    } while (ring->count > 0 && !ring_entry(ring, 0)->keyframe);
+
+    if (ring->count == 0)
+        snapshot_ring_clear(ring);
+    else
+        ring->arena_head = ring_entry(ring, 0)->offset;
+}
+
+// Find room for length contiguous bytes, returns the offset or -1 if full
+static int64_t ring_fit(const SnapshotRing *ring, uint32_t length)
+{
+    if (ring->count == 0)
+        return 0;
+    if (ring->arena_tail == ring->arena_head)
+        return -1;
+    if (ring->arena_tail > ring->arena_head)
+    {
+        if (ring->arena_tail + length <= ring->arena_size)
+            return ring->arena_tail;
+        if (length <= ring->arena_head)
+            return 0; // wrap, the bytes past the tail are wasted until then
+        return -1;
+    }
+    if (ring->arena_tail + length <= ring->arena_head)
+        return ring->arena_tail;
+    return -1;
+}
+
+void snapshot_ring_record(SnapshotRing *ring)
+{
+    uint8_t state[SNAPSHOT_SIZE];
+    uint8_t encoded[SNAPSHOT_DELTA_MAX];
+
+    // update_game() does not tick once the game is over
+    if (ring->count > 0 && ring_entry(ring, ring->count - 1)->tick == game_tick)
+        return;
+
+    snapshot_save(state);
+
+    bool keyframe = ring->count == 0 || ring->since_keyframe >= ring->keyframe_interval;
+    size_t length;
+    if (keyframe)
+    {
+        // A keyframe is a delta against all zeros so one decoder handles both
+        static const uint8_t zero[SNAPSHOT_SIZE];
+        length = snapshot_delta_encode(zero, state, encoded);
+    }
+    else
+    {
+        length = snapshot_delta_encode(ring->last, state, encoded);
+    }
+
+    int64_t offset;
+    while (ring->count == ring->capacity || (offset = ring_fit(ring, (uint32_t)length)) < 0)
+        ring_drop_oldest_group(ring);
+
+    // Dropping the group we were about to delta against leaves an orphan
+    if (!keyframe && ring->count == 0)
+    {
+        snapshot_ring_record(ring);
+        return;
+    }
+
+    memcpy(ring->arena + offset, encoded, length);
+
+    SnapshotEntry *entry = ring_entry(ring, ring->count);
+    entry->tick = game_tick;
+    entry->offset = (uint32_t)offset;
+    entry->length = (uint16_t)length;
+    entry->keyframe = keyframe;
+
+    ring->count++;
+    ring->arena_tail = (uint32_t)offset + (uint32_t)length;
+    ring->bytes_stored += (uint32_t)length;
+    ring->since_keyframe = keyframe ? 1 : ring->since_keyframe + 1;
+    memcpy(ring->last, state, SNAPSHOT_SIZE);
+}
+
+bool snapshot_ring_restore(SnapshotRing *ring, uint32_t tick)
+{
+    if (ring->count == 0)
+        return false;
+
+    // Ticks are strictly increasing, binary search for the entry
+    int lo = 0, hi = ring->count - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        uint32_t t = ring_entry(ring, mid)->tick;
+        if (t == tick)
+        {
+            found = mid;
+            break;
+        }
+        if (t < tick)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    if (found < 0)
+        return false;
+
+    int key = found;
+    while (!ring_entry(ring, key)->keyframe)
+        key--;
+
+    memset(ring->scratch, 0, SNAPSHOT_SIZE);
+    for (int n = key; n <= found; n++)
+    {
+        SnapshotEntry *entry = ring_entry(ring, n);
+        if (!snapshot_delta_apply(ring->scratch, ring->arena + entry->offset, entry->length))
+            return false;
+    }
+    if (!snapshot_load(ring->scratch, SNAPSHOT_SIZE))
+        return false;
+
+    // Everything after the restored tick is a future that no longer happens
+    SnapshotEntry *restored = ring_entry(ring, found);
+    for (int n = found + 1; n < ring->count; n++)
+        ring->bytes_stored -= ring_entry(ring, n)->length;
+    ring->count = found + 1;
+    ring->arena_tail = restored->offset + restored->length;
+    ring->since_keyframe = found - key + 1;
+    memcpy(ring->last, ring->scratch, SNAPSHOT_SIZE);
+    return true;
+}
+
+bool snapshot_ring_oldest(const SnapshotRing *ring, uint32_t *tick)
+{
+    if (ring->count == 0)
+        return false;
+    *tick = ring_entry(ring, 0)->tick;
+    return true;
+}
+
+bool snapshot_ring_newest(const SnapshotRing *ring, uint32_t *tick)
+{
+    if (ring->count == 0)
+        return false;
+    *tick = ring_entry(ring, ring->count - 1)->tick;
+    return true;
+}
+
+double snapshot_ring_bytes_per_second(const SnapshotRing *ring, int ticks_per_second)
+{
+    if (ring->count == 0)
+        return 0.0;
+
+    double bytes = ring->bytes_stored + (double)ring->count * sizeof(SnapshotEntry);
+    return bytes * ticks_per_second / ring->count;
+}
@@ -0,0 +1,82 @@
+// snapshot.h
+// Binary save/restore of the simulation state plus a rewind history.
+// A snapshot is a fixed-size little-endian image of everything in game.h
+// that update_game() reads or writes. The history ring keeps a keyframe
+// every N ticks and XOR deltas (run-length coded) for the ticks between,
+// so restoring any tick only replays at most N-1 small deltas.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "game.h"
+
+#define SNAPSHOT_VERSION 3
+
+// version + tick + rng + ten counters + flags
+#define SNAPSHOT_HEADER_SIZE (1 + 4 + 4 + 10 * 4 + 1)
+// x, y, dx, dy + hits/active byte + hit points/behaviour byte
+#define SNAPSHOT_TARGET_SIZE (4 * 4 + 2)
+// x, y (active flags are packed into a bitmask)
+#define SNAPSHOT_BULLET_SIZE (2 * 4)
+#define SNAPSHOT_BULLET_MASK_SIZE ((MAX_BULLETS + 7) / 8)
+
+#define SNAPSHOT_SIZE (SNAPSHOT_HEADER_SIZE +                    \
+                       MAX_TARGETS * SNAPSHOT_TARGET_SIZE +      \
+                       SNAPSHOT_BULLET_MASK_SIZE +               \
+                       MAX_BULLETS * SNAPSHOT_BULLET_SIZE)
+
+// Worst case for a delta where every byte changed
+#define SNAPSHOT_DELTA_MAX (SNAPSHOT_SIZE + 16)
+
+typedef struct
+{
+    uint32_t tick;
+    uint32_t offset; // start of the record in the arena
+    uint16_t length;
+    bool keyframe;
+} SnapshotEntry;
+
+typedef struct
+{
+    SnapshotEntry *entries;
+    int capacity;
+    int first; // index of the oldest entry
+    int count;
+
+    uint8_t *arena;
+    uint32_t arena_size;
+    uint32_t arena_head; // start of the oldest record
+    uint32_t arena_tail; // where the next record is written
+    uint32_t bytes_stored;
+
+    int keyframe_interval;
+    int since_keyframe;
+
+    uint8_t last[SNAPSHOT_SIZE];    // newest state, base for the next delta
+    uint8_t scratch[SNAPSHOT_SIZE]; // decode buffer for restores
+} SnapshotRing;
+
+// Single snapshots
+size_t snapshot_save(uint8_t *out);
+bool snapshot_load(const uint8_t *in, size_t length);
+uint32_t snapshot_checksum(const uint8_t *state);
+
+// XOR delta between two snapshots. apply() xors the delta into state in place,
+// so it turns base into cur (and cur back into base).
+size_t snapshot_delta_encode(const uint8_t *base, const uint8_t *cur, uint8_t *out);
+bool snapshot_delta_apply(uint8_t *state, const uint8_t *delta, size_t length);
+
+// Rewind history
+bool snapshot_ring_init(SnapshotRing *ring, int max_ticks, uint32_t arena_bytes, int keyframe_interval);
+void snapshot_ring_free(SnapshotRing *ring);
+void snapshot_ring_clear(SnapshotRing *ring);
+void snapshot_ring_record(SnapshotRing *ring);
+bool snapshot_ring_restore(SnapshotRing *ring, uint32_t tick);
+bool snapshot_ring_oldest(const SnapshotRing *ring, uint32_t *tick);
+bool snapshot_ring_newest(const SnapshotRing *ring, uint32_t *tick);
+double snapshot_ring_bytes_per_second(const SnapshotRing *ring, int ticks_per_second);
+
+#endif
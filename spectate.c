@@ -0,0 +1,130 @@
+// spectate.c
+// Console viewer for the telemetry feed of a running game. Prints the
+// score line and new events ten times a second, optionally with a small
+// ASCII map of the field (like the old console version of the game).
+// Stops once the game closes the feed.
+//
+// usage: spectate [--name /shm_name] [--map] [--frames N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "telemetry.h"
+
+#define MAP_WIDTH 75
+#define MAP_HEIGHT 20
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static void plot(char map[MAP_HEIGHT][MAP_WIDTH + 1], const TelemetryFrame *f, float x, float y, char ch)
+{
+    int c = (int)(x * MAP_WIDTH / f->world_width); // the whole world, squeezed
+    int r = (int)(y * MAP_HEIGHT / (SCREEN_HEIGHT - 100)); // skip the control panel
+    if (c >= 0 && c < MAP_WIDTH && r >= 0 && r < MAP_HEIGHT)
+        map[r][c] = ch;
+}
+
+static void draw_map(const TelemetryFrame *f)
+{
+    char map[MAP_HEIGHT][MAP_WIDTH + 1];
+    for (int r = 0; r < MAP_HEIGHT; r++)
+    {
+        memset(map[r], ' ', MAP_WIDTH);
+        map[r][MAP_WIDTH] = '\0';
+    }
+
+    for (int i = 0; i < MAX_BULLETS; i++)
+        if (f->bullets[i].active)
+            plot(map, f, f->bullets[i].x, f->bullets[i].y, '|');
+    for (int i = 0; i < MAX_TARGETS; i++)
+        if (f->targets[i].active)
+            plot(map, f, f->targets[i].x, f->targets[i].y, f->targets[i].hits ? '1' : 'O');
+    plot(map, f, (float)f->shooter_x, (float)f->shooter_y, 'A');
+    if (f->player_count > 1)
+        plot(map, f, (float)f->partner_x, (float)f->shooter_y, 'B');
+
+    for (int r = 0; r < MAP_HEIGHT; r++)
+        printf("|%s|\n", map[r]);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *name = TELEMETRY_DEFAULT_NAME;
+    bool show_map = false;
+    long frames = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--map") == 0)
+            show_map = true;
+        else if (i + 1 < argc && strcmp(argv[i], "--name") == 0)
+            name = argv[++i];
+        else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0)
+            frames = atol(argv[++i]);
+    }
+
+    Telemetry feed;
+    if (!telemetry_open_reader(&feed, name))
+    {
+        printf("No telemetry at %s. Start the game with --telemetry first.\n", name);
+        return 1;
+    }
+
+    TelemetryFrame frame;
+    TelemetryEvent events[256];
+    uint32_t last_tick = 0xFFFFFFFFu;
+
+    while (frames != 0)
+    {
+        // Checked first, so everything written before the close is still
+        // printed by this last pass
+        bool closed = telemetry_closed(&feed);
+        if (telemetry_read_frame(&feed, &frame) && frame.tick != last_tick)
+        {
+            last_tick = frame.tick;
+            if (show_map)
+                draw_map(&frame);
+            printf("tick %6u  score %3d  bullets %2d/%d  killed %2d/%d  shooter %4d%s%s\n",
+                   frame.tick, frame.score, frame.bullets_remaining, MAX_BULLETS,
+                   frame.targets_killed, frame.targets_total, frame.shooter_x,
+                   (frame.flags & TELEMETRY_WON) ? "  WON" : "",
+                   (frame.flags & TELEMETRY_LOST) ? "  LOST" : "");
+        }
+
+        int n;
+        while ((n = telemetry_read_events(&feed, events, 256)) > 0)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                if (events[i].index >= 0)
+                    printf("  [%6u] %s #%d\n", events[i].tick, telemetry_event_name(events[i].type), events[i].index);
+                else
+                    printf("  [%6u] %s\n", events[i].tick, telemetry_event_name(events[i].type));
+            }
+        }
+        if (feed.missed)
+        {
+            printf("  (missed %llu events)\n", (unsigned long long)feed.missed);
+            feed.missed = 0;
+        }
+
+        if (closed)
+        {
+            printf("The game closed the feed.\n");
+            break;
+        }
+
+        fflush(stdout);
+        if (frames > 0)
+            frames--;
+        sleep_ms(100);
+    }
+
+    telemetry_close(&feed);
+    return 0;
+}
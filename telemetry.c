@@ -0,0 +1,334 @@
+// telemetry.c
+// Shared-memory state feed. See telemetry.h for the protocol.
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+#include "telemetry.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define EVENT_MASK (TELEMETRY_EVENT_CAPACITY - 1)
+#define READ_RETRIES 64
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint32_t seq; // odd while the writer is inside
+    TelemetryFrame frame;
+} FrameSlot;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    _Atomic uint32_t closed; // set by the writer on its way out
+    _Alignas(64) _Atomic uint32_t latest; // slot readers should copy
+    _Alignas(64) _Atomic uint64_t event_head; // events ever written
+    FrameSlot slots[2];
+    TelemetryEvent events[TELEMETRY_EVENT_CAPACITY];
+} TelemetryShared;
+
+const char *telemetry_event_name(uint16_t type)
+{
+    switch (type)
+    {
+    case GAME_EVENT_SHOT:
+        return "shot";
+    case GAME_EVENT_HIT:
+        return "hit";
+    case GAME_EVENT_KILL:
+        return "kill";
+    case GAME_EVENT_WIN:
+        return "win";
+    case GAME_EVENT_LOSE:
+        return "lose";
+    }
+    return "?";
+}
+
+#ifdef _WIN32
+
+bool telemetry_open_writer(Telemetry *t, const char *name)
+{
+    (void)name;
+    memset(t, 0, sizeof(*t));
+    return false;
+}
+
+void telemetry_publish(Telemetry *t)
+{
+    (void)t;
+}
+
+void telemetry_event(Telemetry *t, uint32_t tick, GameEventType type, int index)
+{
+    (void)t;
+    (void)tick;
+    (void)type;
+    (void)index;
+}
+
+bool telemetry_open_reader(Telemetry *t, const char *name)
+{
+    (void)name;
+    memset(t, 0, sizeof(*t));
+    return false;
+}
+
+bool telemetry_read_frame(Telemetry *t, TelemetryFrame *frame)
+{
+    (void)t;
+    (void)frame;
+    return false;
+}
+
+int telemetry_read_events(Telemetry *t, TelemetryEvent *events, int max_events)
+{
+    (void)t;
+    (void)events;
+    (void)max_events;
+    return 0;
+}
+
+bool telemetry_closed(Telemetry *t)
+{
+    (void)t;
+    return true;
+}
+
+void telemetry_close(Telemetry *t)
+{
+    (void)t;
+}
+
+#else
+
+// On failure the caller still owns fd
+static bool map_shared(Telemetry *t, int fd, int prot)
+{
+    void *p = mmap(NULL, sizeof(TelemetryShared), prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    t->shared = p;
+    t->fd = fd;
+    return true;
+}
+
+// ---- writer ----
+
+bool telemetry_open_writer(Telemetry *t, const char *name)
+{
+    memset(t, 0, sizeof(*t));
+    if (strlen(name) >= sizeof(t->name))
+        return false;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, sizeof(TelemetryShared)) != 0 || !map_shared(t, fd, PROT_READ | PROT_WRITE))
+    {
+        close(fd);
+        return false;
+    }
+
+    // A previous run may have left the segment behind; start it over
+    TelemetryShared *sh = t->shared;
+    memset(sh, 0, sizeof(*sh));
+    sh->version = TELEMETRY_VERSION;
+    atomic_thread_fence(memory_order_release);
+    sh->magic = TELEMETRY_MAGIC;
+    t->writer = true;
+    strcpy(t->name, name);
+    return true;
+}
+
+static void fill_frame(TelemetryFrame *f)
+{
+    f->tick = game_tick;
+    f->shooter_x = shooter_x;
+    f->shooter_y = shooter_y;
+    f->partner_x = partner_x;
+    f->player_count = player_count;
+    f->bullets_used = bullets_used;
+    f->bullets_remaining = bullets_remaining;
+    f->score = score;
+    f->targets_killed = targets_killed;
+    f->targets_total = targets_total;
+    f->world_width = world_width;
+    f->flags = (game_won ? TELEMETRY_WON : 0) | (game_lost ? TELEMETRY_LOST : 0);
+
+    for (int i = 0; i < MAX_TARGETS; i++)
+    {
+        f->targets[i].x = targets[i].x;
+        f->targets[i].y = targets[i].y;
+        f->targets[i].dx = targets[i].dx;
+        f->targets[i].dy = targets[i].dy;
+        f->targets[i].active = targets[i].active;
+        f->targets[i].hits = (uint8_t)targets[i].hits;
+        f->targets[i].hit_points = (uint8_t)targets[i].hit_points;
+        f->targets[i].behaviour = (uint8_t)targets[i].behaviour;
+    }
+    for (int i = 0; i < MAX_BULLETS; i++)
+    {
+        f->bullets[i].x = bullets[i].x;
+        f->bullets[i].y = bullets[i].y;
+        f->bullets[i].active = bullets[i].active;
+    }
+}
+
+void telemetry_publish(Telemetry *t)
+{
+    if (!t->shared || !t->writer)
+        return;
+
+    TelemetryShared *sh = t->shared;
+    uint32_t next = 1 - atomic_load_explicit(&sh->latest, memory_order_relaxed);
+    FrameSlot *slot = &sh->slots[next];
+
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    fill_frame(&slot->frame);
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&sh->latest, next, memory_order_release);
+}
+
+void telemetry_event(Telemetry *t, uint32_t tick, GameEventType type, int index)
+{
+    if (!t->shared || !t->writer)
+        return;
+
+    TelemetryShared *sh = t->shared;
+    uint64_t head = atomic_load_explicit(&sh->event_head, memory_order_relaxed);
+    TelemetryEvent *e = &sh->events[head & EVENT_MASK];
+    e->tick = tick;
+    e->type = (uint16_t)type;
+    e->index = (int16_t)index;
+    atomic_store_explicit(&sh->event_head, head + 1, memory_order_release);
+}
+
+// ---- reader ----
+
+bool telemetry_open_reader(Telemetry *t, const char *name)
+{
+    memset(t, 0, sizeof(*t));
+
+    // Readers map the feed read-only, they cannot disturb the game
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+
+    if (lseek(fd, 0, SEEK_END) < (off_t)sizeof(TelemetryShared) || !map_shared(t, fd, PROT_READ))
+    {
+        close(fd);
+        return false;
+    }
+
+    TelemetryShared *sh = t->shared;
+    if (sh->magic != TELEMETRY_MAGIC || sh->version != TELEMETRY_VERSION)
+    {
+        telemetry_close(t);
+        return false;
+    }
+
+    // Start from now rather than replaying whatever is still in the ring
+    t->cursor = atomic_load_explicit(&sh->event_head, memory_order_acquire);
+    return true;
+}
+
+bool telemetry_read_frame(Telemetry *t, TelemetryFrame *frame)
+{
+    TelemetryShared *sh = t->shared;
+    if (!sh)
+        return false;
+
+    for (int attempt = 0; attempt < READ_RETRIES; attempt++)
+    {
+        uint32_t index = atomic_load_explicit(&sh->latest, memory_order_acquire);
+        FrameSlot *slot = &sh->slots[index];
+
+        uint32_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        if (before == 0 || (before & 1))
+            continue; // never written, or being written right now
+
+        memcpy(frame, &slot->frame, sizeof(*frame));
+        atomic_thread_fence(memory_order_acquire);
+
+        uint32_t after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+        if (before == after)
+            return true;
+    }
+    return false;
+}
+
+int telemetry_read_events(Telemetry *t, TelemetryEvent *events, int max_events)
+{
+    TelemetryShared *sh = t->shared;
+    if (!sh)
+        return 0;
+
+    uint64_t head = atomic_load_explicit(&sh->event_head, memory_order_acquire);
+    if (t->cursor > head)
+        t->cursor = head; // the game restarted the feed
+    if (head - t->cursor > TELEMETRY_EVENT_CAPACITY)
+    {
+        t->missed += head - TELEMETRY_EVENT_CAPACITY - t->cursor;
+        t->cursor = head - TELEMETRY_EVENT_CAPACITY;
+    }
+
+    uint64_t start = t->cursor;
+    int count = 0;
+    while (start + count < head && count < max_events)
+    {
+        events[count] = sh->events[(start + count) & EVENT_MASK];
+        count++;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    // Anything the writer lapped while we were copying may be torn. The
+    // writer fills slot now before publishing it, so the event that slot
+    // held, now - CAPACITY, may be half overwritten as well.
+    uint64_t now = atomic_load_explicit(&sh->event_head, memory_order_relaxed);
+    uint64_t oldest_valid = now >= TELEMETRY_EVENT_CAPACITY ? now - TELEMETRY_EVENT_CAPACITY + 1 : 0;
+    int skip = 0;
+    if (oldest_valid > start)
+    {
+        skip = oldest_valid - start > (uint64_t)count ? count : (int)(oldest_valid - start);
+        memmove(events, events + skip, (count - skip) * sizeof(*events));
+        t->missed += skip;
+    }
+
+    t->cursor = start + count;
+    return count - skip;
+}
+
+bool telemetry_closed(Telemetry *t)
+{
+    TelemetryShared *sh = t->shared;
+    return !sh || atomic_load_explicit(&sh->closed, memory_order_acquire);
+}
+
+void telemetry_close(Telemetry *t)
+{
+    if (!t->shared)
+        return;
+    if (t->writer)
+    {
+        // Released after the last frame and event, so a reader that sees
+        // the flag has already been able to read them
+        TelemetryShared *sh = t->shared;
+        atomic_store_explicit(&sh->closed, 1, memory_order_release);
+        shm_unlink(t->name);
+    }
+    munmap(t->shared, sizeof(TelemetryShared));
+    close(t->fd);
+    t->shared = NULL;
+}
+
+#endif
@@ -0,0 +1,96 @@
+// telemetry.h
+// Live game state for other processes (spectators, analytics) through
+// POSIX shared memory. The game never waits on a reader:
+// - Each tick the full state goes into one of two frame buffers, each
+//   guarded by a seqlock. The writer fills the buffer readers are not
+//   pointed at, then flips `latest`. A reader copies the latest buffer and
+//   retries if the sequence number moved while it was copying.
+// - Game events go into an append-only ring. Readers keep their own
+//   cursor; one that falls a whole ring behind skips ahead and is told how
+//   many events it missed.
+// When the game closes the feed it marks it closed, so attached readers
+// can tell a finished game from a paused one, and unlinks it so nobody
+// new attaches to a dead feed.
+// Not available on Windows; there the writer calls quietly do nothing.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game.h"
+
+#define TELEMETRY_MAGIC 0x4d4c4554u // "TELM"
+#define TELEMETRY_VERSION 4
+#define TELEMETRY_DEFAULT_NAME "/shooter_telemetry"
+#define TELEMETRY_EVENT_CAPACITY 4096 // power of two
+
+#define TELEMETRY_WON 1
+#define TELEMETRY_LOST 2
+
+typedef struct
+{
+    float x, y, dx, dy;
+    uint8_t active;
+    uint8_t hits;
+    uint8_t hit_points;
+    uint8_t behaviour;
+} TelemetryTarget;
+
+typedef struct
+{
+    float x, y;
+    uint8_t active;
+    uint8_t pad[3];
+} TelemetryBullet;
+
+typedef struct
+{
+    uint32_t tick;
+    int32_t shooter_x, shooter_y;
+    int32_t partner_x;
+    int32_t player_count;
+    int32_t bullets_used;
+    int32_t bullets_remaining;
+    int32_t score;
+    int32_t targets_killed;
+    int32_t targets_total;
+    int32_t world_width;
+    uint32_t flags; // TELEMETRY_WON / TELEMETRY_LOST
+    TelemetryTarget targets[MAX_TARGETS];
+    TelemetryBullet bullets[MAX_BULLETS];
+} TelemetryFrame;
+
+typedef struct
+{
+    uint32_t tick;
+    uint16_t type;  // GameEventType
+    int16_t index;  // bullet or target, -1 for win/lose
+} TelemetryEvent;
+
+// Handle for either side of the feed
+typedef struct
+{
+    void *shared;
+    int fd;
+    bool writer;
+    char name[64];    // writer: unlinked on close
+    uint64_t cursor;  // reader: next event to read
+    uint64_t missed;  // reader: events lost to lapping
+} Telemetry;
+
+// Writer (the game)
+bool telemetry_open_writer(Telemetry *t, const char *name);
+void telemetry_publish(Telemetry *t);
+void telemetry_event(Telemetry *t, uint32_t tick, GameEventType type, int index);
+
+// Reader
+bool telemetry_open_reader(Telemetry *t, const char *name);
+bool telemetry_read_frame(Telemetry *t, TelemetryFrame *frame);
+int telemetry_read_events(Telemetry *t, TelemetryEvent *events, int max_events);
+bool telemetry_closed(Telemetry *t); // the writer has gone; read what is left, then stop
+
+void telemetry_close(Telemetry *t);
+const char *telemetry_event_name(uint16_t type);
+
+#endif